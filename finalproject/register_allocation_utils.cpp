@@ -0,0 +1,133 @@
+#include "register_allocation_utils.hpp"
+
+// register of each var id: r<n> for n > 0, m<-n> for spilled n < 0, unassigned if 0
+std::string reg_name(int reg) {
+    return reg < 0 ? "m" + std::to_string(-1 * reg) : "r" + std::to_string(reg);
+}
+
+void assign_registers(Block& block, std::span<const Instr> block_ir, const IrFunc& f, const std::vector<int>& var_to_reg) {
+    for (int i = 0; i < block.size(); i++) {
+        auto& instr = block[i];
+        const auto& instr_ir = block_ir[i];
+        if ((instr_ir.keys & KEY_DEST) && var_to_reg[instr_ir.dest] != 0) {
+            instr["dest"] = reg_name(var_to_reg[instr_ir.dest]);
+        }
+        auto args = instr_args(f, instr_ir);
+        for (int j = 0; j < args.size(); j++) {
+            if (var_to_reg[args[j]] != 0) {
+                // spilled args need to be fetched from "memory" with a copy id instruction
+                instr["args"][j] = reg_name(var_to_reg[args[j]]);
+            }
+        }
+    }
+}
+
+using Interval = std::pair<SymId, std::pair<int, int>>; // var id and its (start, end)
+
+// [intervals] maps each var id to the (start, end) instructions it is live after, start -1 if not live.
+// [spilled_vars] counts the memory slots m<n> handed out so far in the function, so that a var
+// spilled in one block never shares a slot with one spilled in another
+std::vector<int> linear_scan_block(const std::vector<std::pair<int, int>>& intervals, int num_registers, std::vector<int>& free_registers, std::vector<int>& var_to_reg, int& spilled_vars) {
+    // sort intervals by start time; ties keep var id (name) order
+    std::vector<Interval> sorted_intervals;
+    for (SymId var = 0; var < intervals.size(); var++) {
+        if (intervals[var].first != -1) sorted_intervals.push_back({var, intervals[var]});
+    }
+    std::stable_sort(sorted_intervals.begin(), sorted_intervals.end(),
+              [](const auto& a, const auto& b) { return a.second.first < b.second.first; });
+
+    std::unordered_set<SymId> active_intervals;
+
+    // heap for expiring intervals sorted in increasing endpoint
+    auto cmp = [](const Interval& a, const Interval& b) {
+        return a.second.second > b.second.second;
+    };
+    std::priority_queue<Interval, std::vector<Interval>, decltype(cmp)> expiring_intervals(cmp);
+
+    for (const auto& interval : sorted_intervals) {
+        const auto& var = interval.first;
+        const auto& start = interval.second.first;
+        const auto& end = interval.second.second;
+
+        // expire old intervals
+        while (!expiring_intervals.empty() && expiring_intervals.top().second.second < start) {
+            active_intervals.erase(expiring_intervals.top().first);
+            free_registers.push_back(var_to_reg[expiring_intervals.top().first]);
+            var_to_reg[expiring_intervals.top().first] = 0;
+            expiring_intervals.pop();
+        }
+
+        // registers still held by vars of earlier blocks can run out before the active set fills
+        if (active_intervals.size() == num_registers || (free_registers.empty() && var_to_reg[var] == 0)) {
+            if (expiring_intervals.empty()) {
+                spilled_vars++;
+                var_to_reg[var] = -1 * spilled_vars;
+                continue;
+            }
+            const auto& spill = expiring_intervals.top();
+            if (spill.second.second > end) {
+                var_to_reg[var] = var_to_reg[spill.first];
+                spilled_vars++;
+                var_to_reg[spill.first] = -1 * spilled_vars; // mark as spilled
+                active_intervals.erase(spill.first);
+                expiring_intervals.pop();
+                active_intervals.insert(var);
+                expiring_intervals.push(interval);
+            } else {
+                spilled_vars++;
+                var_to_reg[var] = -1 * spilled_vars;
+            }
+            
+        } else {
+            if (var_to_reg[var] != 0) {
+                continue;
+            }
+            int reg = free_registers.back();
+            free_registers.pop_back();
+            var_to_reg[var] = reg;
+            active_intervals.insert(var);
+            expiring_intervals.push(interval);
+        }
+    }
+
+    return var_to_reg;
+}
+
+void linear_scan(json& func, int num_registers) {
+    AnalysisManager am(func);
+    linear_scan(func, num_registers, am);
+}
+
+void linear_scan(json& func, int num_registers, AnalysisManager& am) {
+    const CfgIr& cfg_ir = am.get<CfgIrAnalysis>();
+    const IrFunc& f = cfg_ir.ir;
+    InstrFacts live_vars = live_instr_facts(cfg_ir, am.get<LiveVarsAnalysis>());
+    Cfg cfg = take_cfg(func);
+    auto& blocks = cfg.blocks;
+
+    std::vector<int> var_to_reg(f.vars.size());
+    std::vector<int> free_registers;
+    for (int i = num_registers; i > 0; i--) {
+        free_registers.push_back(i);
+    }
+
+    int spilled_vars = 0;
+
+    std::vector<bool> param_renamed(f.params.size());
+    for (int i = 0; i < blocks.size(); i++) {
+        auto& block = blocks[i];
+        var_to_reg = linear_scan_block(live_vars.after_ranges(i), num_registers, free_registers, var_to_reg, spilled_vars);
+
+        assign_registers(block, cfg_ir.block(i), f, var_to_reg);
+
+        for (int p = 0; p < f.params.size(); p++) {
+            SymId var = f.params[p].var;
+            if (!param_renamed[p] && var_to_reg[var] != 0) {
+                func["args"][p]["name"] = reg_name(var_to_reg[var]);
+                param_renamed[p] = true;
+            }
+        }
+    }
+
+    write_blocks(func, std::move(blocks));
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <queue>
+#include <span>
+#include <unordered_set>
+#include <vector>
+
+#include "../task4/dataflow_utils.hpp"
+
+// rename the vars of [func] to [num_registers] registers r<n>, spilling to m<n>, by linear scan
+void linear_scan(json& func, int num_registers);
+
+// same, taking the lowered body and live vars from [am]
+void linear_scan(json& func, int num_registers, AnalysisManager& am);
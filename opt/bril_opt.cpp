@@ -0,0 +1,138 @@
+#include "pass_manager.hpp"
+#include "../task2/cfg/stream_utils.hpp"
+#include "../task3/dce_utils.hpp"
+#include "../task3/lvn_utils.hpp"
+#include "../task6/ssa_utils.hpp"
+#include "../task6/sccp_utils.hpp"
+#include "../task8/licm_utils.hpp"
+#include "../finalproject/register_allocation_utils.hpp"
+
+// a pass factory for passes that take no argument
+PassFactory plain(PassFn fn){
+    return [fn](const std::string& arg) -> PassFn {
+        if(!arg.empty()){
+            throw std::invalid_argument("unexpected pass argument " + arg);
+        }
+        return fn;
+    };
+}
+
+// same, for a pass that uses no analyses and always leaves [preserved] valid
+PassFactory plain(void (*fn)(json&), PreservedAnalyses preserved){
+    return plain([fn, preserved](json& func, AnalysisManager&){
+        fn(func);
+        return preserved;
+    });
+}
+
+void register_passes(PassManager& pm){
+    // lvn and linear_scan rewrite instructions one for one; tdce, live_dce and from_ssa may empty
+    // out (and so drop) an unlabeled block, and licm adds preheaders
+    pm.register_pass("dce", plain(tdce, PreservedAnalyses::none()));
+    pm.register_pass("live-dce", plain(live_dce, PreservedAnalyses::none()));
+    pm.register_pass("lvn", plain(lvn, preserve_cfg_shape()));
+    pm.register_pass("ssa-from", plain(from_ssa, PreservedAnalyses::none()));
+    pm.register_pass("licm", plain([](json& func, AnalysisManager& am){
+        licm(func, am);
+        return PreservedAnalyses::none();
+    }));
+
+    // to_ssa only adds instructions to existing blocks, but filling the empty entry block the cfg
+    // puts ahead of a loop header turns it into a real block 0, renumbering the rest. ssa-to=pruned
+    // and ssa-to=semi-pruned place fewer phi-nodes
+    pm.register_pass("ssa-to", [](const std::string& arg) -> PassFn {
+        PhiPlacement placement = PhiPlacement::Minimal;
+        if(arg == "pruned") placement = PhiPlacement::Pruned;
+        else if(arg == "semi-pruned") placement = PhiPlacement::SemiPruned;
+        else if(!arg.empty()){
+            throw std::invalid_argument("ssa-to takes pruned or semi-pruned, not " + arg);
+        }
+        return [placement](json& func, AnalysisManager& am){
+            bool added_entry = am.get<CfgAnalysis>().entryIdx != 0;
+            to_ssa(func, am, placement);
+            return added_entry ? PreservedAnalyses::none() : preserve_cfg_shape();
+        };
+    });
+
+    // sccp folds branches and deletes the blocks they no longer reach
+    pm.register_pass("sccp", plain([](json& func, AnalysisManager& am){
+        sccp(func, am);
+        return PreservedAnalyses::none();
+    }));
+
+    pm.register_pass("linear-scan", [](const std::string& arg) -> PassFn {
+        int num_registers;
+        try {
+            num_registers = std::stoi(arg);
+        } catch (const std::exception&) {
+            throw std::invalid_argument("linear-scan needs a number of registers, e.g. linear-scan=3");
+        }
+        return [num_registers](json& func, AnalysisManager& am){
+            linear_scan(func, num_registers, am);
+            return preserve_cfg_shape();
+        };
+    });
+}
+
+void usage(const char* prog, const PassManager& pm){
+    std::cerr << "Usage: " << prog << " --passes=<pass>[,<pass>...] [--time-passes] [-j N]" << std::endl;
+    std::cerr << "passes:";
+    for(const auto& name: pm.registered()){
+        std::cerr << " " << name;
+    }
+    std::cerr << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    PassManager pm;
+    register_passes(pm);
+
+    // parse args
+    int jobs;
+    try {
+        jobs = take_jobs_arg(argc, argv);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+    bool time_passes = false;
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        try {
+            if(arg.starts_with("--passes=")){
+                pm.add_passes(arg.substr(9));
+            } else if(arg == "--time-passes"){
+                time_passes = true;
+            } else {
+                usage(argv[0], pm);
+                return 1;
+            }
+        } catch (const std::invalid_argument& e) {
+            std::cerr << "ERROR: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    if(pm.empty()){
+        usage(argv[0], pm);
+        return 1;
+    }
+
+    // run the pipeline on each function as it is read, in the input's format
+    BrilFormat format = sniff_format(std::cin);
+    try {
+        transform_funcs(std::cin, std::cout, format, [&](json& func){ pm.run(func); }, jobs);
+    } catch (const json::parse_error& e) {
+        std::cerr << "ERROR: Failed to parse JSON from stdin: " << e.what() << std::endl;
+        return 1;
+    } catch (const std::runtime_error& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+    if(format == BrilFormat::Json) std::cout << std::endl;
+
+    if(time_passes){
+        pm.print_timings(std::cerr);
+    }
+
+    return 0;
+}
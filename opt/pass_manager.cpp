@@ -0,0 +1,78 @@
+#include "pass_manager.hpp"
+
+#include <iomanip>
+
+void PassManager::register_pass(const std::string& name, PassFactory factory){
+    registry[name] = std::move(factory);
+}
+
+std::vector<std::string> PassManager::registered() const {
+    std::vector<std::string> names;
+    for(const auto& [name, factory]: registry){
+        names.push_back(name);
+    }
+    return names;
+}
+
+void PassManager::add_pass(const std::string& name, const std::string& arg){
+    auto it = registry.find(name);
+    if(it == registry.end()){
+        throw std::invalid_argument("unknown pass " + name);
+    }
+    pipeline.push_back({arg.empty() ? name : name + "=" + arg, it->second(arg)});
+}
+
+void PassManager::add_passes(const std::string& spec){
+    size_t start = 0;
+    while(start <= spec.size()){
+        size_t end = spec.find(',', start);
+        if(end == std::string::npos) end = spec.size();
+
+        std::string pass = spec.substr(start, end - start);
+        if(!pass.empty()){
+            size_t eq = pass.find('=');
+            if(eq == std::string::npos){
+                add_pass(pass);
+            } else {
+                add_pass(pass.substr(0, eq), pass.substr(eq + 1));
+            }
+        }
+        start = end + 1;
+    }
+}
+
+void PassManager::run(json& func){
+    AnalysisManager am(func);
+    std::vector<std::chrono::nanoseconds> times(pipeline.size());
+    for(int i = 0; i < pipeline.size(); i++){
+        auto start = std::chrono::steady_clock::now();
+        am.invalidate(pipeline[i].run(func, am));
+        times[i] = std::chrono::steady_clock::now() - start;
+    }
+
+    std::lock_guard<std::mutex> guard(timing_lock);
+    for(int i = 0; i < pipeline.size(); i++){
+        pipeline[i].time += times[i];
+    }
+    num_funcs++;
+    num_analyses += am.computed();
+}
+
+void PassManager::print_timings(std::ostream& out) const {
+    using ms = std::chrono::duration<double, std::milli>;
+
+    size_t width = 5;
+    for(const auto& pass: pipeline){
+        width = std::max(width, pass.name.size());
+    }
+
+    std::chrono::nanoseconds total{0};
+    out << std::fixed << std::setprecision(3);
+    out << std::left << std::setw(width) << "pass" << "  " << std::right << std::setw(10) << "time (ms)" << "\n";
+    for(const auto& pass: pipeline){
+        out << std::left << std::setw(width) << pass.name << "  " << std::right << std::setw(10) << ms(pass.time).count() << "\n";
+        total += pass.time;
+    }
+    out << std::left << std::setw(width) << "total" << "  " << std::right << std::setw(10) << ms(total).count()
+        << "  (" << num_funcs << " functions, " << num_analyses << " analyses computed)" << std::endl;
+}
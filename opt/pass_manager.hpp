@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "../task2/cfg/analysis_manager.hpp"
+
+// a pass rewrites one function in place, asking [am] for the analyses it needs, and returns the
+// analyses it left valid
+using PassFn = std::function<PreservedAnalyses(json& func, AnalysisManager& am)>;
+
+// builds a pass from its argument, the text after '=' in a pass spec (empty if there is none);
+// throws std::invalid_argument if the argument is bad
+using PassFactory = std::function<PassFn(const std::string& arg)>;
+
+struct Pass {
+    std::string name; // as written in the spec, e.g. "linear-scan=3"
+    PassFn run;
+    std::chrono::nanoseconds time{0}; // spent in this pass over all functions so far, summed over threads
+};
+
+// runs a pipeline of registered passes over each function, keeping the function in memory between
+// passes, and times each pass of the pipeline separately. analyses are shared between the passes
+// run on one function until a pass invalidates them. run may be called from several threads
+// at once, on different functions
+class PassManager {
+public:
+    void register_pass(const std::string& name, PassFactory factory);
+
+    // names of the registered passes, sorted
+    std::vector<std::string> registered() const;
+
+    // append one pass to the pipeline; throws std::invalid_argument if [name] is not registered
+    void add_pass(const std::string& name, const std::string& arg = "");
+
+    // append the passes of a comma-separated spec such as "dce,lvn,dce,linear-scan=3"
+    void add_passes(const std::string& spec);
+
+    // run the whole pipeline on [func]
+    void run(json& func);
+
+    // time spent in each pass of the pipeline, one line per pass, then the total
+    void print_timings(std::ostream& out) const;
+
+    bool empty() const { return pipeline.empty(); }
+
+private:
+    std::map<std::string, PassFactory> registry;
+    std::vector<Pass> pipeline;
+    int num_funcs = 0;
+    long num_analyses = 0; // analysis results computed over all functions
+    std::mutex timing_lock; // guards the times and counts while the pipeline runs
+};
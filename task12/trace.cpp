@@ -6,6 +6,7 @@
 #include <stack>
 #include <map>
 
+#include "../task2/cfg/stream_utils.hpp"
 #include "../task5/dom_utils.hpp"
 
 using FuncArgsMap = std::unordered_map<std::string, std::vector<json>>;
@@ -95,24 +96,15 @@ Trace getTrace(std::string trace_f, FuncArgsMap func_args){
         }
     }
 
-    // insert speculate, commit, jmp to .trace_success, .guard_failed
+    // insert speculate and commit; the jump out of the trace is added when it is stitched in
     auto speculate = json{
         {"op", "speculate"},
     };
     auto commit = json{
         {"op", "commit"},
     };
-    auto jmp_trace_sucess = json{
-        {"labels", {"trace_sucess"}},
-        {"op", "jmp"},
-    };
-    auto guard_failed = json{
-        {"label", "guard_failed"},
-    };
     trace.insert(trace.begin(), speculate);
     trace.push_back(commit);
-    trace.push_back(jmp_trace_sucess);
-    trace.push_back(guard_failed);
 
     trace_raw.close();
 
@@ -130,31 +122,36 @@ void printTrace(Trace t){
 
 // insert trace into main
 void insertTrace(json& func, Trace t){
-    Cfg cfg = get_cfg_func(func);
-    auto& blocks = cfg.blocks;
-    
-    // insert hot path
-    auto& entry = blocks[cfg.entryIdx];
-    auto& trace = t.trace;
-    entry.insert(entry.begin(), trace.begin(), trace.end());
+    Cfg cfg = take_cfg(func);
+    int entry = cfg.entryIdx;
 
-    // insert .trace_success
-    for(int i = 0; i < blocks.size(); i++){
-        auto& b = blocks[i];
+    // the trace ends where execution left off, so split that block there at .trace_sucess
+    int success = -1;
+    for(int i = 0; i < cfg.blocks.size() && success == -1; i++){
         if(get_block_name(cfg, i) == t.lastLabel){
-            auto trace_sucess = json{
-                {"label", "trace_sucess"},
-            };
-            b.insert(b.begin() + t.lastOffset + 1, trace_sucess);
+            success = split_block(cfg, i, t.lastOffset + 1, "trace_sucess");
         }
     }
-    
-    // update body of main
-    std::vector<json> new_func_body;
-    for(int idx: cfg.block_order){
-        new_func_body.insert(new_func_body.end(), blocks[idx].begin(), blocks[idx].end());
+    if(success == -1){
+        throw std::runtime_error("trace ends in unknown block " + t.lastLabel);
     }
-    func["instrs"] = new_func_body;
+
+    // hot path in a new entry block; its guards fall back to the old entry at .guard_failed
+    auto& trace = t.trace;
+    std::string failed = block_label(cfg, entry, "guard_failed");
+    for(auto& instr: trace){
+        if(instr.value("op", std::string()) == "guard") instr["labels"][0] = failed;
+    }
+    int hot = insert_block_before(cfg, entry, {});
+    cfg.blocks[hot] = std::move(trace);
+    redirect_edge(cfg, hot, entry, success);
+
+    // redirect_edge moved the fall-through edge to .trace_sucess; the guards still reach the old entry
+    cfg.succs.insert(hot, entry);
+    cfg.preds.insert(entry, hot);
+
+    // update body of main
+    write_blocks(func, std::move(cfg.blocks), cfg.block_order);
 }
 
 int main(int argc, char* argv[]) {
@@ -167,41 +164,39 @@ int main(int argc, char* argv[]) {
     auto bril_f = f + ".json";
     auto trace_f = f + ".trace"; 
 
-    // open bril json
-    json j;
+    // get function args, streaming through the program once
+    FuncArgsMap func_args;
     try {
         std::ifstream input(bril_f);
         if (!input) {
             std::cerr << "ERROR: Could not open file " << bril_f << "\n";
             return 1;
         }
-        input >> j;
+        for_each_func(input, [&](json& func){
+            std::string name = func["name"];
+            for(auto arg: func["args"]){
+                func_args[name].push_back(arg);
+            }
+        });
     } catch (const json::parse_error& e) {
         std::cerr << "ERROR: Failed to parse Bril JSON from file, " << e.what() << std::endl;
         return 1;
-    }
-
-    // get function args
-    FuncArgsMap func_args;
-    for(auto& func: j["functions"]){
-        std::string name = func["name"];
-        for(auto arg: func["args"]){
-            func_args[name].push_back(arg);
-        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
     }
 
     // process trace
     auto t = getTrace(trace_f, func_args);
     // printTrace(t);
     
-    // stitch in trace
-    for(auto& func: j["functions"]){
+    // stitch in trace, streaming through the program again
+    std::ifstream input(bril_f);
+    transform_funcs(input, std::cout, [&](json& func){
         if(func["name"] == "main"){
             insertTrace(func, t);
         }
-    }
-
-    std::cout << j;
+    });
 
     return 0;
 }
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <any>
+#include <typeindex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "cfg_utils.hpp"
+
+// set of analyses a pass leaves valid
+class PreservedAnalyses {
+public:
+    static PreservedAnalyses none() { return {}; }
+
+    static PreservedAnalyses all(){
+        PreservedAnalyses pa;
+        pa.keep_all = true;
+        return pa;
+    }
+
+    template<class... A>
+    PreservedAnalyses& preserve(){
+        (kept.insert(typeid(A)), ...);
+        return *this;
+    }
+
+    bool preserved(std::type_index analysis) const {
+        return keep_all || kept.contains(analysis);
+    }
+
+private:
+    bool keep_all = false;
+    std::unordered_set<std::type_index> kept;
+};
+
+// analyses of one function, each computed the first time it is asked for and kept until a pass
+// invalidates it. an analysis is a type with
+//
+//   using Result = ...;
+//   static Result run(const json& func, AnalysisManager& am);
+//
+// whose run may ask [am] for the analyses it builds on. results stay valid while the function is
+// rewritten, but results that view the function body (CfgAnalysis) must be asked for before a pass
+// takes the body out of the function
+class AnalysisManager {
+public:
+    explicit AnalysisManager(const json& func) : func(func) {}
+
+    template<class A>
+    const typename A::Result& get(){
+        auto it = results.find(typeid(A));
+        if(it == results.end()){
+            typename A::Result result = A::run(func, *this);
+            it = results.emplace(typeid(A), std::move(result)).first;
+            num_computed++;
+        }
+        return *std::any_cast<typename A::Result>(&it->second);
+    }
+
+    template<class A>
+    bool cached() const {
+        return results.contains(typeid(A));
+    }
+
+    // drop every result not in [preserved]
+    void invalidate(const PreservedAnalyses& preserved){
+        std::erase_if(results, [&](const auto& result){ return !preserved.preserved(result.first); });
+    }
+
+    // number of analysis results computed so far
+    int computed() const { return num_computed; }
+
+private:
+    const json& func;
+    std::unordered_map<std::type_index, std::any> results;
+    int num_computed = 0;
+};
+
+// cfg viewing the function body
+struct CfgAnalysis {
+    using Result = Cfg;
+    static Result run(const json& func, AnalysisManager&) { return get_cfg_view(func); }
+};
+
+// function body lowered with vars in name order, split like the cfg blocks
+struct CfgIrAnalysis {
+    using Result = CfgIr;
+    static Result run(const json& func, AnalysisManager&) { return get_cfg_ir(func); }
+};
@@ -0,0 +1,16 @@
+#include "stream_utils.hpp"
+
+// convert a bril program (binary or json) to bril json
+int main() {
+    try {
+        transform_funcs(std::cin, std::cout, BrilFormat::Json, [](json&){});
+    } catch (const json::parse_error& e) {
+        std::cerr << "ERROR: Failed to parse JSON from stdin: " << e.what() << std::endl;
+        return 1;
+    } catch (const std::runtime_error& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << std::endl;
+    return 0;
+}
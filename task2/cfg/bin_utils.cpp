@@ -0,0 +1,311 @@
+#include "bin_utils.hpp"
+
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::endian::native == std::endian::little, "binary bril is little-endian");
+static_assert(sizeof(Instr) == 40 && sizeof(IrParam) == 8 && sizeof(BinFuncHeader) == 64);
+static_assert(sizeof(BinFileHeader) == 16 && sizeof(BinChunkHeader) == 8 && sizeof(BinTrailer) == 16);
+
+static constexpr size_t align8(size_t n){
+    return (n + 7) & ~size_t(7);
+}
+
+static void check(bool ok, const char* what){
+    if(!ok){
+        throw std::runtime_error(std::string("malformed binary bril: ") + what);
+    }
+}
+
+bool is_bin_bril(std::span<const char> bytes){
+    return bytes.size() >= sizeof(BIN_MAGIC) && std::memcmp(bytes.data(), BIN_MAGIC, sizeof(BIN_MAGIC)) == 0;
+}
+
+static uint32_t bin_trailer_magic(){
+    uint32_t magic;
+    std::memcpy(&magic, BIN_MAGIC + 4, sizeof(magic));
+    return magic;
+}
+
+// --- functions ---
+
+static const SymbolTable& func_table(const IrFunc& f, int t){
+    const SymbolTable* tables[] = {&f.vars, &f.labels, &f.funcs, &f.types, &f.strings};
+    return *tables[t];
+}
+
+static SymbolTable& func_table(IrFunc& f, int t){
+    SymbolTable* tables[] = {&f.vars, &f.labels, &f.funcs, &f.types, &f.strings};
+    return *tables[t];
+}
+
+template<typename T>
+static void append(std::vector<char>& out, const T* data, size_t count){
+    const char* bytes = reinterpret_cast<const char*>(data);
+    out.insert(out.end(), bytes, bytes + count * sizeof(T));
+}
+
+std::vector<char> encode_bin_func(const IrFunc& f){
+    // string table, each distinct name stored once
+    std::string strtab;
+    std::unordered_map<std::string,uint32_t> str_offsets;
+    auto add_string = [&](const std::string& s){
+        auto [it, added] = str_offsets.try_emplace(s, strtab.size());
+        if(added){
+            strtab.append(s);
+            strtab.push_back('\0');
+        }
+        return it->second;
+    };
+
+    BinFuncHeader header = {};
+    header.name = add_string(f.name);
+    header.ret_type = f.ret_type;
+    header.has_args_key = f.has_args_key;
+    header.num_params = f.params.size();
+    header.num_instrs = f.instrs.size();
+    header.num_operands = f.operands.size();
+
+    std::vector<uint32_t> sym_offsets;
+    for(int t = 0; t < 5; t++){
+        const auto& table = func_table(f, t);
+        header.num_syms[t] = table.size();
+        for(SymId id = 0; id < table.size(); id++){
+            sym_offsets.push_back(add_string(table.name(id)));
+        }
+    }
+
+    std::string meta = f.meta.empty() ? "" : f.meta.dump();
+    std::string extras = f.extras.empty() ? "" : json(f.extras).dump();
+    header.strtab_bytes = strtab.size();
+    header.meta_bytes = meta.size();
+    header.extras_bytes = extras.size();
+
+    std::vector<char> out;
+    append(out, &header, 1);
+    append(out, f.params.data(), f.params.size());
+    append(out, f.instrs.data(), f.instrs.size());
+    append(out, f.operands.data(), f.operands.size());
+    append(out, sym_offsets.data(), sym_offsets.size());
+    append(out, strtab.data(), strtab.size());
+    append(out, meta.data(), meta.size());
+    append(out, extras.data(), extras.size());
+    out.resize(align8(out.size()));
+    return out;
+}
+
+IrFunc decode_bin_func(std::span<const char> payload){
+    check(payload.size() >= sizeof(BinFuncHeader), "truncated function header");
+    BinFuncHeader header;
+    std::memcpy(&header, payload.data(), sizeof(header));
+
+    size_t num_syms = 0;
+    for(uint32_t n: header.num_syms){
+        num_syms += n;
+    }
+    size_t needed = sizeof(BinFuncHeader) + size_t(header.num_params) * sizeof(IrParam)
+        + size_t(header.num_instrs) * sizeof(Instr) + size_t(header.num_operands) * sizeof(SymId)
+        + num_syms * sizeof(uint32_t) + size_t(header.strtab_bytes) + header.meta_bytes + header.extras_bytes;
+    check(needed <= payload.size(), "truncated function");
+
+    // sections follow the header back to back; params and instrs stay 8-byte aligned
+    const char* cur = payload.data() + sizeof(BinFuncHeader);
+    auto take = [&](size_t bytes){
+        const char* start = cur;
+        cur += bytes;
+        return start;
+    };
+
+    IrFunc f;
+    f.params.resize(header.num_params);
+    std::memcpy(f.params.data(), take(f.params.size() * sizeof(IrParam)), f.params.size() * sizeof(IrParam));
+    f.instrs.resize(header.num_instrs);
+    std::memcpy(f.instrs.data(), take(f.instrs.size() * sizeof(Instr)), f.instrs.size() * sizeof(Instr));
+    f.operands.resize(header.num_operands);
+    std::memcpy(f.operands.data(), take(f.operands.size() * sizeof(SymId)), f.operands.size() * sizeof(SymId));
+    std::vector<uint32_t> sym_offsets(num_syms);
+    std::memcpy(sym_offsets.data(), take(num_syms * sizeof(uint32_t)), num_syms * sizeof(uint32_t));
+    std::string_view strtab(take(header.strtab_bytes), header.strtab_bytes);
+    std::string_view meta(take(header.meta_bytes), header.meta_bytes);
+    std::string_view extras(take(header.extras_bytes), header.extras_bytes);
+
+    check(strtab.empty() || strtab.back() == '\0', "unterminated string table");
+    auto string_at = [&](uint32_t offset){
+        check(offset < strtab.size(), "string offset out of range");
+        return std::string(strtab.data() + offset);
+    };
+
+    // interning in id order reproduces the ids
+    f.name = string_at(header.name);
+    size_t k = 0;
+    for(int t = 0; t < 5; t++){
+        auto& table = func_table(f, t);
+        for(uint32_t i = 0; i < header.num_syms[t]; i++){
+            table.intern(string_at(sym_offsets[k++]));
+        }
+        check(table.size() == header.num_syms[t], "duplicate symbol");
+    }
+    f.ret_type = header.ret_type;
+    f.has_args_key = header.has_args_key;
+    f.meta = meta.empty() ? json::object() : json::parse(meta);
+    if(!extras.empty()){
+        f.extras = json::parse(extras).get<std::vector<json>>();
+    }
+
+    // ids must be in range before the IR touches them
+    check(f.ret_type == NO_SYM || f.ret_type < f.types.size(), "return type out of range");
+    for(const auto& param: f.params){
+        check(param.var < f.vars.size() && param.type < f.types.size(), "param out of range");
+    }
+    for(const auto& instr: f.instrs){
+        check(instr.op <= Opcode::Unknown, "bad opcode");
+        size_t end = size_t(instr.operands) + instr.num_args + instr.num_labels + instr.num_funcs;
+        check(end <= f.operands.size(), "operands out of range");
+        for(SymId id: instr_args(f, instr)) check(id < f.vars.size(), "arg out of range");
+        for(SymId id: instr_labels(f, instr)) check(id < f.labels.size(), "label out of range");
+        for(SymId id: instr_funcs(f, instr)) check(id < f.funcs.size(), "func out of range");
+        const auto& dest_table = instr.op == Opcode::Label ? f.labels : f.vars;
+        check(instr.dest == NO_SYM || instr.dest < dest_table.size(), "dest out of range");
+        check(instr.type == NO_SYM || instr.type < f.types.size(), "type out of range");
+        check(instr.extra == NO_SYM || instr.extra < f.extras.size(), "extra out of range");
+        check(instr.value_kind != ValueKind::Char || instr.value.c < f.strings.size(), "char out of range");
+    }
+
+    return f;
+}
+
+// --- programs ---
+
+std::vector<uint64_t> bin_func_offsets(std::span<const char> program){
+    check(is_bin_bril(program) && program.size() >= sizeof(BinFileHeader) + sizeof(BinTrailer), "missing header or trailer");
+    BinFileHeader header;
+    std::memcpy(&header, program.data(), sizeof(header));
+    check(header.version == BIN_VERSION, "unsupported version");
+
+    BinTrailer trailer;
+    std::memcpy(&trailer, program.data() + program.size() - sizeof(BinTrailer), sizeof(trailer));
+    check(trailer.magic == bin_trailer_magic(), "bad trailer");
+
+    BinChunkHeader chunk;
+    uint64_t index_size = sizeof(BinChunkHeader) + uint64_t(trailer.num_funcs) * sizeof(uint64_t);
+    check(trailer.index_offset + index_size <= program.size(), "index out of range");
+    std::memcpy(&chunk, program.data() + trailer.index_offset, sizeof(chunk));
+    check(chunk.tag == CHUNK_INDEX && chunk.size == trailer.num_funcs * sizeof(uint64_t), "bad index");
+
+    std::vector<uint64_t> offsets(trailer.num_funcs);
+    std::memcpy(offsets.data(), program.data() + trailer.index_offset + sizeof(BinChunkHeader), chunk.size);
+    return offsets;
+}
+
+BinWriter::BinWriter(std::ostream& out) : out(out) {
+    BinFileHeader header = {};
+    std::memcpy(header.magic, BIN_MAGIC, sizeof(BIN_MAGIC));
+    header.version = BIN_VERSION;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    offset = sizeof(header);
+}
+
+void BinWriter::write_chunk(uint32_t tag, std::span<const char> payload){
+    BinChunkHeader chunk = {tag, (uint32_t) payload.size()};
+    out.write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+    out.write(payload.data(), payload.size());
+    offset += sizeof(chunk) + payload.size();
+}
+
+void BinWriter::write_func(const IrFunc& f){
+    func_offsets.push_back(offset);
+    write_chunk(CHUNK_FUNC, encode_bin_func(f));
+    out.flush();
+}
+
+void BinWriter::finish(const json& rest){
+    if(rest.is_object() && !rest.empty()){
+        std::string text = rest.dump();
+        text.resize(align8(text.size()), ' ');
+        write_chunk(CHUNK_REST, text);
+    }
+
+    BinTrailer trailer = {offset, (uint32_t) func_offsets.size(), bin_trailer_magic()};
+    write_chunk(CHUNK_INDEX, {reinterpret_cast<const char*>(func_offsets.data()), func_offsets.size() * sizeof(uint64_t)});
+    out.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+    out.flush();
+}
+
+json for_each_bin_func(std::span<const char> program, const std::function<void(IrFunc&)>& on_func){
+    // function chunks are found through the index, the rest chunk sits just before it
+    json rest = json::object();
+    uint64_t end = sizeof(BinFileHeader);
+    for(uint64_t offset: bin_func_offsets(program)){
+        BinChunkHeader chunk;
+        check(offset + sizeof(chunk) <= program.size(), "function offset out of range");
+        std::memcpy(&chunk, program.data() + offset, sizeof(chunk));
+        check(chunk.tag == CHUNK_FUNC && offset + sizeof(chunk) + chunk.size <= program.size(), "bad function chunk");
+        IrFunc f = decode_bin_func(program.subspan(offset + sizeof(chunk), chunk.size));
+        on_func(f);
+        end = offset + sizeof(chunk) + chunk.size;
+    }
+
+    BinChunkHeader chunk;
+    check(end + sizeof(chunk) <= program.size(), "truncated program");
+    std::memcpy(&chunk, program.data() + end, sizeof(chunk));
+    if(chunk.tag == CHUNK_REST){
+        check(end + sizeof(chunk) + chunk.size <= program.size(), "truncated rest chunk");
+        auto text = program.subspan(end + sizeof(chunk), chunk.size);
+        rest = json::parse(text.begin(), text.end());
+    }
+    return rest;
+}
+
+json for_each_bin_func(std::istream& in, const std::function<void(IrFunc&)>& on_func){
+    BinFileHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    check(in && is_bin_bril({header.magic, sizeof(header.magic)}), "missing header");
+    check(header.version == BIN_VERSION, "unsupported version");
+
+    // chunks are read one at a time until the index
+    json rest = json::object();
+    std::vector<uint64_t> buffer; // 8-byte aligned payload storage
+    BinChunkHeader chunk;
+    while(true){
+        in.read(reinterpret_cast<char*>(&chunk), sizeof(chunk));
+        check((bool) in, "truncated program");
+        if(chunk.tag == CHUNK_INDEX) break;
+
+        buffer.resize(align8(chunk.size) / sizeof(uint64_t));
+        std::span<char> payload(reinterpret_cast<char*>(buffer.data()), chunk.size);
+        in.read(payload.data(), payload.size());
+        check((bool) in, "truncated chunk");
+
+        if(chunk.tag == CHUNK_FUNC){
+            IrFunc f = decode_bin_func(payload);
+            on_func(f);
+        } else if(chunk.tag == CHUNK_REST){
+            rest = json::parse(payload.begin(), payload.end());
+        }
+    }
+
+    // skip the index and trailer so the stream is left at the end of the program
+    in.ignore(chunk.size + sizeof(BinTrailer));
+    return rest;
+}
+
+MappedFile::MappedFile(int fd){
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) return;
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(addr == MAP_FAILED) return;
+    data = static_cast<const char*>(addr);
+    size = st.st_size;
+}
+
+MappedFile::~MappedFile(){
+    if(data){
+        munmap(const_cast<char*>(data), size);
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "cfg_utils.hpp"
+
+// binary bril: a file header, one chunk per function, an optional chunk holding the program's other
+// top-level keys as json text, an index of function chunk offsets, and a trailer locating the index.
+// chunks are 8-byte aligned and start with a (tag, payload size) pair. a function payload is
+//
+//   BinFuncHeader | IrParam[num_params] | Instr[num_instrs] | SymId[num_operands]
+//   | uint32_t[sum of num_syms] (string table offsets of vars, labels, funcs, types, strings)
+//   | string table (nul-terminated) | meta json text | extras json text
+//
+// so instruction records are the IR's own fixed-width Instr and can be read in place.
+// all integers are little-endian
+
+constexpr char BIN_MAGIC[8] = {'\x7f', 'B', 'R', 'I', 'L', 'B', 'I', 'N'};
+constexpr uint32_t BIN_VERSION = 2;
+
+enum BinChunkTag : uint32_t {
+    CHUNK_FUNC = 'F',
+    CHUNK_REST = 'R',
+    CHUNK_INDEX = 'I',
+};
+
+struct BinFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct BinChunkHeader {
+    uint32_t tag;
+    uint32_t size; // payload bytes, a multiple of 8
+};
+
+struct BinFuncHeader {
+    uint32_t name;     // string table offset
+    uint32_t ret_type; // id in types, or NO_SYM
+    uint32_t has_args_key;
+    uint32_t num_params;
+    uint32_t num_instrs;
+    uint32_t num_operands;
+    uint32_t num_syms[5]; // vars, labels, funcs, types, strings
+    uint32_t strtab_bytes;
+    uint32_t meta_bytes;
+    uint32_t extras_bytes;
+    uint32_t reserved[2];
+};
+
+struct BinTrailer {
+    uint64_t index_offset; // file offset of the index chunk
+    uint32_t num_funcs;
+    uint32_t magic;        // BIN_MAGIC[4..8]
+};
+
+// true if [bytes] start with BIN_MAGIC
+bool is_bin_bril(std::span<const char> bytes);
+
+// function chunk payload for [f]
+std::vector<char> encode_bin_func(const IrFunc& f);
+
+// decode a function chunk payload; throws std::runtime_error if it is malformed
+IrFunc decode_bin_func(std::span<const char> payload);
+
+// offsets of the function chunks of a whole binary program, read from its index
+std::vector<uint64_t> bin_func_offsets(std::span<const char> program);
+
+// writes a binary program one function at a time
+class BinWriter {
+public:
+    explicit BinWriter(std::ostream& out);
+
+    void write_func(const IrFunc& f);
+
+    // write the other top-level keys (if any), the index and the trailer
+    void finish(const json& rest);
+
+private:
+    std::ostream& out;
+    uint64_t offset = 0;
+    std::vector<uint64_t> func_offsets;
+
+    void write_chunk(uint32_t tag, std::span<const char> payload);
+};
+
+// call [on_func] with each function of a binary program, in order; returns the other top-level keys
+json for_each_bin_func(std::span<const char> program, const std::function<void(IrFunc&)>& on_func);
+
+// same, reading the program sequentially from [in]
+json for_each_bin_func(std::istream& in, const std::function<void(IrFunc&)>& on_func);
+
+// read-only mapping of a whole file; empty if the file cannot be mapped (e.g. a pipe)
+class MappedFile {
+public:
+    explicit MappedFile(int fd);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<const char> bytes() const { return {data, size}; }
+    bool empty() const { return data == nullptr; }
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+};
@@ -0,0 +1,15 @@
+#include "stream_utils.hpp"
+
+// convert a bril program (json or binary) to binary bril
+int main() {
+    try {
+        transform_funcs(std::cin, std::cout, BrilFormat::Binary, [](json&){});
+    } catch (const json::parse_error& e) {
+        std::cerr << "ERROR: Failed to parse JSON from stdin: " << e.what() << std::endl;
+        return 1;
+    } catch (const std::runtime_error& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
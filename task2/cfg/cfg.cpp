@@ -1,26 +1,27 @@
 #include "cfg_utils.hpp"
+#include "stream_utils.hpp"
 
 
 int main() {
-    // open bril json
-    json j;
+    // print each function as it is read
     try {
-        std::cin >> j;
+        for_each_func(std::cin, [](json& func){
+            std::cout << "function: " << func["name"] << std::endl;
+            if(func.contains("args")){
+                std::cout << "\targs: " << func["args"] << std::endl;
+            }
+
+            auto bb = get_blocks(func);
+            print_bb(bb);
+            auto cfg = get_cfg(std::move(bb));
+            print_cfg(cfg);
+        });
     } catch (const json::parse_error& e) {
         std::cerr << "ERROR: Failed to parse JSON from stdin: " << e.what() << std::endl;
         return 1;
-    }
-    
-    for(const auto& func: j["functions"]){
-        std::cout << "function: " << func["name"] << std::endl;
-        if(func.contains("args")){
-            std::cout << "\targs: " << func["args"] << std::endl;
-        }
-
-        auto bb = get_blocks(func);
-        print_bb(bb);
-        auto cfg = get_cfg(bb);
-        print_cfg(cfg);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
     }
 
     return 0;
@@ -0,0 +1,129 @@
+#include <sstream>
+
+#include "cfg_utils.hpp"
+#include "stream_utils.hpp"
+
+// apply cfg edits to every function and print the program, checking that the edges the edits
+// maintained match the cfg of the program they wrote. blocks are named as get_block_name does
+//   split-edge:FROM,TO[,LABEL]  split-block:B,AT[,LABEL]  redirect:FROM,OLD_TO,NEW_TO
+//   merge:A,B  delete-unreachable
+
+struct Edit {
+    std::string name;
+    std::vector<std::string> args;
+};
+
+Edit parse_edit(const std::string& arg){
+    Edit edit;
+    auto colon = arg.find(':');
+    edit.name = arg.substr(0, colon);
+    if(colon != std::string::npos){
+        std::stringstream rest(arg.substr(colon + 1));
+        std::string field;
+        while(std::getline(rest, field, ',')){
+            edit.args.push_back(field);
+        }
+    }
+    return edit;
+}
+
+int find_block(const Cfg& cfg, const std::string& name){
+    for(int b: cfg.block_order){
+        if(get_block_name(cfg, b) == name) return b;
+    }
+    throw std::invalid_argument("no block " + name);
+}
+
+void apply_edit(Cfg& cfg, const Edit& edit){
+    auto& args = edit.args;
+    auto arity = [&](size_t lo, size_t hi){
+        if(args.size() < lo || args.size() > hi){
+            throw std::invalid_argument("wrong number of arguments to " + edit.name);
+        }
+    };
+    auto label = [&](size_t i){ return i < args.size() ? args[i] : std::string(); };
+
+    if(edit.name == "split-edge"){
+        arity(2, 3);
+        split_edge(cfg, find_block(cfg, args[0]), find_block(cfg, args[1]), label(2));
+    } else if(edit.name == "split-block"){
+        arity(2, 3);
+        split_block(cfg, find_block(cfg, args[0]), std::stoi(args[1]), label(2));
+    } else if(edit.name == "redirect"){
+        arity(3, 3);
+        redirect_edge(cfg, find_block(cfg, args[0]), find_block(cfg, args[1]), find_block(cfg, args[2]));
+    } else if(edit.name == "merge"){
+        arity(2, 2);
+        merge_blocks(cfg, find_block(cfg, args[0]), find_block(cfg, args[1]));
+    } else if(edit.name == "delete-unreachable"){
+        arity(0, 0);
+        delete_unreachable_blocks(cfg);
+    } else {
+        throw std::invalid_argument("unknown edit " + edit.name);
+    }
+}
+
+// edges between the blocks in block_order, by name; a synthetic entry block is left out
+std::set<std::pair<std::string,std::string>> named_edges(const Cfg& cfg){
+    std::set<std::pair<std::string,std::string>> edges;
+    for(int b: cfg.block_order){
+        if(cfg.block(b).empty()) continue;
+        for(int s: cfg.succs.at(b)){
+            edges.insert({get_block_name(cfg, b), get_block_name(cfg, s)});
+        }
+    }
+    return edges;
+}
+
+// label every block of a copy of [cfg], write it out and compare its edges with a fresh cfg of it
+void check_edges(const Cfg& cfg, const json& func){
+    Cfg labeled = cfg;
+    for(int b: labeled.block_order){
+        block_label(labeled, b);
+    }
+    auto kept = named_edges(labeled);
+
+    json written = func;
+    write_blocks(written, std::move(labeled.blocks), labeled.block_order);
+    auto rebuilt = named_edges(get_cfg_func(written));
+
+    if(kept != rebuilt){
+        std::string msg = "edges out of step in " + func["name"].get<std::string>() + ":";
+        for(const auto& [from, to]: kept){
+            if(!rebuilt.contains({from, to})) msg += " extra " + from + "->" + to;
+        }
+        for(const auto& [from, to]: rebuilt){
+            if(!kept.contains({from, to})) msg += " missing " + from + "->" + to;
+        }
+        throw std::runtime_error(msg);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<Edit> edits;
+    for(int i = 1; i < argc; i++){
+        edits.push_back(parse_edit(argv[i]));
+    }
+
+    try {
+        transform_funcs(std::cin, std::cout, BrilFormat::Json, [&](json& func){
+            Cfg cfg = take_cfg(func);
+            for(const auto& edit: edits){
+                apply_edit(cfg, edit);
+            }
+            check_edges(cfg, func);
+            write_blocks(func, std::move(cfg.blocks), cfg.block_order);
+        });
+    } catch (const json::parse_error& e) {
+        std::cerr << "ERROR: Failed to parse JSON from stdin: " << e.what() << std::endl;
+        return 1;
+    } catch (const std::runtime_error& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << std::endl;
+    return 0;
+}
@@ -1,115 +1,506 @@
 #include "cfg_utils.hpp"
 
-std::vector<Block> get_blocks(const json& func){
-    std::vector<Block> blocks;
-    Block cur_block;
+#include <numeric>
+
+std::vector<BlockRange> get_block_ranges(const json& func){
+    std::vector<BlockRange> ranges;
     const std::set<std::string> terms = {"br","jmp","ret"};
-    
+    const auto& instrs = func["instrs"];
+
+    // instructions after a terminator are dropped until the next label, so a range ends there
+    int begin = 0;
     bool got_ret = false;
-    for(const auto& instr: func["instrs"]){
+    for(int i = 0; i < instrs.size(); i++){
+        const auto& instr = instrs[i];
         bool is_label = instr.contains("label");
         bool is_term = !is_label && terms.count(instr["op"]);
 
         if(got_ret && !is_label) continue;
-        if(is_term) got_ret = true;
-
-        if(!is_label){
-            cur_block.push_back(instr);
-        } else{
-            got_ret = false;
-        }
 
-        if(is_label || is_term){
-            if(!cur_block.empty()){
-                blocks.push_back(cur_block);
-                cur_block.clear();
+        if(is_label){
+            if(!got_ret && begin < i){
+                ranges.push_back({begin, i});
             }
+            begin = i;
+            got_ret = false;
+        } else if(is_term){
+            ranges.push_back({begin, i + 1});
+            got_ret = true;
         }
+    }
 
-        if(is_label){
-            cur_block.push_back(instr);
-        }
+    if(!got_ret && begin < instrs.size()){
+        ranges.push_back({begin, (int) instrs.size()});
     }
 
-    if(!cur_block.empty()){
-        blocks.push_back(cur_block);
+    return ranges;
+}
+
+std::vector<Block> get_blocks(const json& func){
+    std::vector<Block> blocks;
+    const auto& instrs = func["instrs"];
+    for(auto [begin, end]: get_block_ranges(func)){
+        blocks.emplace_back(instrs.begin() + begin, instrs.begin() + end);
     }
+    return blocks;
+}
 
+std::vector<Block> take_blocks(json& func){
+    std::vector<Block> blocks;
+    auto& instrs = func["instrs"];
+    for(auto [begin, end]: get_block_ranges(func)){
+        blocks.emplace_back(std::make_move_iterator(instrs.begin() + begin), std::make_move_iterator(instrs.begin() + end));
+    }
+    instrs = json::array();
     return blocks;
 }
 
-std::map<std::string,int> get_label_ids(std::vector<Block> bb){
-    std::map<std::string,int> labels_to_id;
-    for(int i = 0; i < bb.size(); i++){
-        auto& block = bb[i];
-        if(block[0].contains("label")){
-            labels_to_id[block[0]["label"]] = i;
+void write_blocks(json& func, std::vector<Block>&& blocks, const std::vector<int>& order){
+    size_t num_instrs = 0;
+    for(const auto& b: blocks){
+        num_instrs += b.size();
+    }
+
+    json::array_t new_func_body;
+    new_func_body.reserve(num_instrs);
+    for(int b_id: order){
+        auto& b = blocks[b_id];
+        new_func_body.insert(new_func_body.end(), std::make_move_iterator(b.begin()), std::make_move_iterator(b.end()));
+    }
+    blocks.clear();
+    func["instrs"] = std::move(new_func_body);
+}
+
+void write_blocks(json& func, std::vector<Block>&& blocks){
+    std::vector<int> order(blocks.size());
+    std::iota(order.begin(), order.end(), 0);
+    write_blocks(func, std::move(blocks), order);
+}
+
+Adjacency::Adjacency(int num_nodes, const std::vector<std::pair<int,int>>& edge_list)
+    : start(num_nodes + 1), len(num_nodes), cap(num_nodes), edges(edge_list.size()) {
+    // bucket edges by source
+    for(auto [from, to]: edge_list){
+        start[from + 1]++;
+    }
+    for(int b = 0; b < num_nodes; b++){
+        start[b + 1] += start[b];
+    }
+    for(auto [from, to]: edge_list){
+        edges[start[from] + len[from]++] = to;
+    }
+    start.pop_back();
+
+    // sort and dedup each row, leaving the dropped slots as capacity
+    for(int b = 0; b < num_nodes; b++){
+        auto row_begin = edges.begin() + start[b];
+        std::sort(row_begin, row_begin + len[b]);
+        cap[b] = len[b];
+        len[b] = std::unique(row_begin, row_begin + len[b]) - row_begin;
+    }
+}
+
+bool Adjacency::has_edge(int b, int t) const {
+    auto row = at(b);
+    return std::binary_search(row.begin(), row.end(), t);
+}
+
+Adjacency Adjacency::transpose() const {
+    // rows are visited in order, so every reversed row comes out sorted
+    std::vector<std::pair<int,int>> reversed;
+    for(int b = 0; b < size(); b++){
+        for(int t: at(b)){
+            reversed.push_back({t, b});
         }
     }
-    return labels_to_id;
+    return Adjacency(size(), reversed);
 }
 
-Cfg get_cfg(std::vector<Block> bb){
-    auto labels_to_id = get_label_ids(bb);
-    Cfg cfg;
-    cfg.blocks = bb;
+int Adjacency::add_node(){
+    start.push_back(edges.size());
+    len.push_back(0);
+    cap.push_back(0);
+    return size() - 1;
+}
 
-    int i;
-    for(i = 0; i < bb.size(); i++){
-        // initialize with empty sets
-        cfg.preds[i];
-        cfg.succs[i];
-
-        auto& block = bb[i];
-        auto& last = block[block.size()-1];
-        std::set<int> succ;
-        
-        if(last["op"] == "jmp"){
-            succ.insert(labels_to_id[last["labels"][0]]);
-        } else if(last["op"] == "br"){
-            succ.insert(labels_to_id[last["labels"][0]]);
-            succ.insert(labels_to_id[last["labels"][1]]);
-        } else if(last["op"] != "ret" && i != bb.size()-1){
-            succ.insert(i+1);
+void Adjacency::insert(int b, int t){
+    auto row = at(b);
+    int pos = std::lower_bound(row.begin(), row.end(), t) - row.begin();
+    if(pos < len[b] && row[pos] == t) return;
+
+    // move a full row to the end with doubled capacity
+    if(len[b] == cap[b]){
+        int new_cap = std::max(2, 2 * cap[b]);
+        int new_start = edges.size();
+        edges.resize(edges.size() + new_cap);
+        std::copy_n(edges.begin() + start[b], len[b], edges.begin() + new_start);
+        start[b] = new_start;
+        cap[b] = new_cap;
+    }
+
+    auto row_begin = edges.begin() + start[b];
+    std::copy_backward(row_begin + pos, row_begin + len[b], row_begin + len[b] + 1);
+    row_begin[pos] = t;
+    len[b]++;
+}
+
+void Adjacency::erase(int b, int t){
+    auto row_begin = edges.begin() + start[b];
+    auto row_end = row_begin + len[b];
+    auto it = std::lower_bound(row_begin, row_end, t);
+    if(it == row_end || *it != t) return;
+    std::copy(it + 1, row_end, it);
+    len[b]--;
+}
+
+void Adjacency::clear(int b){
+    len[b] = 0;
+}
+
+std::span<const json> Cfg::block(int b) const {
+    if(instrs){
+        return {instrs->data() + ranges[b].begin, (size_t) (ranges[b].end - ranges[b].begin)};
+    }
+    return blocks[b];
+}
+
+// intern block labels; label_block[id] is the block starting with that label
+template<typename B>
+static void get_label_ids(int num_blocks, B block, SymbolTable& labels, std::vector<int>& label_block){
+    for(int i = 0; i < num_blocks; i++){
+        const auto& first = block(i)[0];
+        if(first.contains("label")){
+            SymId id = labels.intern(first["label"].template get<std::string>());
+            label_block.resize(labels.size());
+            label_block[id] = i;
         }
+    }
+}
+
+// fill in the edges, entry and block order of [cfg] from its [num_blocks] blocks;
+// block(i) gives the instructions of block i. returns true if an empty entry block must be added
+template<typename B>
+static bool link_blocks(Cfg& cfg, int num_blocks, B block){
+    SymbolTable labels;
+    std::vector<int> label_block;
+    get_label_ids(num_blocks, block, labels, label_block);
+    auto label_to_block = [&](const json& label){
+        SymId id = labels.find(label.get<std::string>());
+        return id == NO_SYM ? 0 : label_block[id];
+    };
 
-        cfg.succs[i] = succ;
+    std::vector<std::pair<int,int>> edge_list;
+    bool entry_has_preds = false;
+    auto add_edge = [&](int from, int to){
+        edge_list.push_back({from, to});
+        entry_has_preds |= to == 0;
+    };
 
-        for(int node: succ){
-            cfg.preds[node].insert(i);
+    int i;
+    for(i = 0; i < num_blocks; i++){
+        auto instrs = block(i);
+        auto& last = instrs[instrs.size()-1];
+        auto op = last.value("op", std::string()); // labels have no op
+        
+        if(op == "jmp"){
+            add_edge(i, label_to_block(last["labels"][0]));
+        } else if(op == "br"){
+            add_edge(i, label_to_block(last["labels"][0]));
+            add_edge(i, label_to_block(last["labels"][1]));
+        } else if(op != "ret" && i != num_blocks-1){
+            add_edge(i, i+1);
         }
     }
 
     // add empty entry block if first block has predecessor
     cfg.entryIdx = 0;
-    if(!cfg.preds[0].empty()){
-        Block emptyBlock;
-        cfg.blocks.push_back(emptyBlock);
-        cfg.succs[i].insert(0);
-        cfg.preds[0].insert(i);
+    int num_nodes = num_blocks;
+    if(entry_has_preds){
+        edge_list.push_back({i, 0});
         cfg.entryIdx = i;
-        cfg.preds[i];
+        num_nodes++;
     }
 
+    cfg.succs = Adjacency(num_nodes, edge_list);
+    cfg.preds = cfg.succs.transpose();
+
     // construct block order
     auto& block_order = cfg.block_order;
-    for(int i = 0; i < cfg.blocks.size(); i++){
+    for(int i = 0; i < num_nodes; i++){
         block_order.push_back(i);
     }
     if(cfg.entryIdx != 0){
-        block_order.insert(block_order.begin(), cfg.blocks.size()-1);
+        block_order.insert(block_order.begin(), num_nodes-1);
         block_order.pop_back();
     }
 
+    return entry_has_preds;
+}
+
+Cfg get_cfg(std::vector<Block> bb){
+    Cfg cfg;
+    cfg.blocks = std::move(bb);
+    auto block = [&](int i){ return std::span<const json>(cfg.blocks[i]); };
+    if(link_blocks(cfg, cfg.blocks.size(), block)){
+        cfg.blocks.push_back(Block());
+    }
+    for(int b = 0; b < cfg.blocks.size(); b++){
+        const auto& blk = cfg.blocks[b];
+        if(!blk.empty() && blk[0].contains("label")){
+            cfg.label_blocks.emplace(blk[0]["label"].get<std::string>(), b);
+        }
+    }
     return cfg;
 }
 
 Cfg get_cfg_func(const json& func){
-    auto bb = get_blocks(func);
-    return get_cfg(bb);
+    return get_cfg(get_blocks(func));
+}
+
+Cfg get_cfg_view(const json& func){
+    Cfg cfg;
+    cfg.instrs = &func["instrs"].get_ref<const json::array_t&>();
+    cfg.ranges = get_block_ranges(func);
+    auto block = [&](int i){ return cfg.block(i); };
+    if(link_blocks(cfg, cfg.ranges.size(), block)){
+        cfg.ranges.push_back({0, 0});
+    }
+    return cfg;
+}
+
+Cfg take_cfg(json& func){
+    return get_cfg(take_blocks(func));
+}
+
+// --- cfg mutation ---
+
+static bool is_jump(const json& instr){
+    std::string op = instr.value("op", std::string());
+    return op == "jmp" || op == "br";
+}
+
+// whether control runs off the end of [blk] into the next block in block_order
+static bool falls_through(const Block& blk){
+    if(blk.empty()) return true;
+    std::string op = blk.back().value("op", std::string());
+    return op != "jmp" && op != "br" && op != "ret";
+}
+
+static std::vector<int>::iterator order_pos(Cfg& cfg, int b){
+    return std::find(cfg.block_order.begin(), cfg.block_order.end(), b);
+}
+
+// block after [b] in block_order, or -1
+static int layout_next(Cfg& cfg, int b){
+    auto it = order_pos(cfg, b);
+    return it == cfg.block_order.end() || it + 1 == cfg.block_order.end() ? -1 : *(it + 1);
 }
 
-void print_bb(std::vector<Block> bb){
+// [hint], or [hint] with a numeric suffix if some block already has it
+static std::string fresh_label(const Cfg& cfg, const std::string& hint){
+    std::string label = hint;
+    for(int n = 1; cfg.label_blocks.contains(label); n++){
+        label = hint + "." + std::to_string(n);
+    }
+    return label;
+}
+
+static int add_block(Cfg& cfg, Block blk){
+    cfg.blocks.push_back(std::move(blk));
+    cfg.succs.add_node();
+    return cfg.preds.add_node();
+}
+
+static void add_edge(Cfg& cfg, int from, int to){
+    cfg.succs.insert(from, to);
+    cfg.preds.insert(to, from);
+}
+
+static void remove_edge(Cfg& cfg, int from, int to){
+    cfg.succs.erase(from, to);
+    cfg.preds.erase(to, from);
+}
+
+// make [from], which used to fall through, reach [to]: by falling through if [to] now follows it,
+// by an explicit jump otherwise
+static void fall_or_jump(Cfg& cfg, int from, int to){
+    if(layout_next(cfg, from) != to){
+        cfg.blocks[from].push_back(json{{"labels", {block_label(cfg, to)}}, {"op", "jmp"}});
+    }
+}
+
+std::string block_label(Cfg& cfg, int b, const std::string& hint){
+    auto& blk = cfg.blocks[b];
+    if(!blk.empty() && blk[0].contains("label")){
+        return blk[0]["label"];
+    }
+    std::string label = fresh_label(cfg, hint.empty() ? "b" + std::to_string(b) : hint);
+    blk.insert(blk.begin(), json{{"label", label}});
+    cfg.label_blocks[label] = b;
+    return label;
+}
+
+int insert_block_before(Cfg& cfg, int b, std::span<const int> from_span, const std::string& label){
+    // copy [from]: it may be a span over a row of the cfg, which the edits below move
+    std::vector<int> from(from_span.begin(), from_span.end());
+
+    int nb = add_block(cfg, Block());
+    if(!label.empty()) block_label(cfg, nb, label);
+
+    // whatever runs before the entry is the new entry
+    if(b == cfg.entryIdx) cfg.entryIdx = nb;
+
+    // a block falling through into [b] that keeps its edge must now jump over the new block
+    auto pos = order_pos(cfg, b);
+    int layout_prev = pos == cfg.block_order.begin() ? -1 : *(pos - 1);
+    bool keeps_edge = std::find(from.begin(), from.end(), layout_prev) == from.end();
+    if(layout_prev != -1 && keeps_edge && falls_through(cfg.blocks[layout_prev]) && cfg.succs.has_edge(layout_prev, b)){
+        cfg.blocks[layout_prev].push_back(json{{"labels", {block_label(cfg, b)}}, {"op", "jmp"}});
+    }
+    cfg.block_order.insert(pos, nb);
+
+    for(int p: from){
+        redirect_edge(cfg, p, b, nb);
+    }
+    add_edge(cfg, nb, b);
+    return nb;
+}
+
+int split_edge(Cfg& cfg, int from, int to, const std::string& label){
+    int single[] = {from};
+    return insert_block_before(cfg, to, single, label);
+}
+
+int split_block(Cfg& cfg, int b, int at, const std::string& label){
+    auto& blk = cfg.blocks[b];
+    Block tail(std::make_move_iterator(blk.begin() + at), std::make_move_iterator(blk.end()));
+    blk.erase(blk.begin() + at, blk.end());
+
+    int nb = add_block(cfg, std::move(tail));
+    if(!label.empty()) block_label(cfg, nb, label);
+    cfg.block_order.insert(order_pos(cfg, b) + 1, nb);
+
+    // the tail takes the terminator, and with it every successor
+    auto succs = cfg.succs.at(b);
+    for(int s: std::vector<int>(succs.begin(), succs.end())){
+        remove_edge(cfg, b, s);
+        add_edge(cfg, nb, s);
+    }
+    add_edge(cfg, b, nb);
+    return nb;
+}
+
+void redirect_edge(Cfg& cfg, int from, int old_to, int new_to){
+    remove_edge(cfg, from, old_to);
+    add_edge(cfg, from, new_to);
+
+    auto& blk = cfg.blocks[from];
+    if(!blk.empty() && is_jump(blk.back())){
+        std::string old_label = block_label(cfg, old_to);
+        std::string new_label = block_label(cfg, new_to);
+        for(auto& target: cfg.blocks[from].back()["labels"]){
+            if(target == old_label) target = new_label;
+        }
+    } else {
+        fall_or_jump(cfg, from, new_to);
+    }
+}
+
+void fold_branch(Cfg& cfg, int b, int target){
+    // label first: labeling [target] may insert into [b] itself
+    std::string label = block_label(cfg, target);
+    cfg.blocks[b].back() = json{{"labels", {label}}, {"op", "jmp"}};
+
+    std::vector<int> others;
+    for(int s: cfg.succs.at(b)){
+        if(s != target) others.push_back(s);
+    }
+    for(int s: others){
+        remove_edge(cfg, b, s);
+    }
+}
+
+void merge_blocks(Cfg& cfg, int a, int b){
+    auto& blk_a = cfg.blocks[a];
+    auto& blk_b = cfg.blocks[b];
+
+    // drop the jump from [a] to [b], and [b]'s label
+    if(!blk_a.empty() && is_jump(blk_a.back())) blk_a.pop_back();
+    auto first = blk_b.begin();
+    if(first != blk_b.end() && first->contains("label")){
+        cfg.label_blocks.erase((*first)["label"].get<std::string>());
+        first++;
+    }
+    int next = falls_through(blk_b) ? layout_next(cfg, b) : -1;
+    blk_a.insert(blk_a.end(), std::make_move_iterator(first), std::make_move_iterator(blk_b.end()));
+    blk_b.clear();
+    cfg.block_order.erase(order_pos(cfg, b));
+
+    // [a] takes over the successors of [b]
+    remove_edge(cfg, a, b);
+    auto succs = cfg.succs.at(b);
+    for(int s: std::vector<int>(succs.begin(), succs.end())){
+        remove_edge(cfg, b, s);
+        add_edge(cfg, a, s);
+    }
+    if(next != -1 && cfg.succs.has_edge(a, next)){
+        fall_or_jump(cfg, a, next);
+    }
+}
+
+// drop the edges, label and instructions of [b], leaving it out of block_order to the caller
+static void clear_block(Cfg& cfg, int b){
+    auto succs = cfg.succs.at(b);
+    for(int s: std::vector<int>(succs.begin(), succs.end())){
+        cfg.preds.erase(s, b);
+    }
+    auto preds = cfg.preds.at(b);
+    for(int p: std::vector<int>(preds.begin(), preds.end())){
+        cfg.succs.erase(p, b);
+    }
+    cfg.succs.clear(b);
+    cfg.preds.clear(b);
+
+    auto& blk = cfg.blocks[b];
+    if(!blk.empty() && blk[0].contains("label")){
+        cfg.label_blocks.erase(blk[0]["label"].get<std::string>());
+    }
+    blk.clear();
+}
+
+void delete_block(Cfg& cfg, int b){
+    clear_block(cfg, b);
+    cfg.block_order.erase(order_pos(cfg, b));
+}
+
+int delete_unreachable_blocks(Cfg& cfg){
+    std::vector<bool> reached(cfg.size());
+    std::vector<int> stack = {cfg.entryIdx};
+    reached[cfg.entryIdx] = true;
+    while(!stack.empty()){
+        int b = stack.back();
+        stack.pop_back();
+        for(int s: cfg.succs.at(b)){
+            if(!reached[s]){
+                reached[s] = true;
+                stack.push_back(s);
+            }
+        }
+    }
+
+    // only blocks still in block_order; the rest were deleted before
+    int num_deleted = 0;
+    for(int b: cfg.block_order){
+        if(!reached[b]){
+            clear_block(cfg, b);
+            num_deleted++;
+        }
+    }
+    std::erase_if(cfg.block_order, [&](int b){ return !reached[b]; });
+    return num_deleted;
+}
+
+void print_bb(const std::vector<Block>& bb){
     std::cout << "\t--- BB ---"  << std::endl;
     for(int i = 0; i < bb.size(); i++){
         std::cout << "\tblock " << i << std::endl;
@@ -119,11 +510,11 @@ void print_bb(std::vector<Block> bb){
     }
 }
 
-void print_cfg(Cfg cfg){
+void print_cfg(const Cfg& cfg){
     std::cout << "\t--- CFG ---"  << std::endl;
-    for(const auto& pair: cfg.succs){
-        std::cout << "\t" << get_block_name(cfg, pair.first) << " goes to ";
-        for(const auto& cur: pair.second){
+    for(int b = 0; b < cfg.size(); b++){
+        std::cout << "\t" << get_block_name(cfg, b) << " goes to ";
+        for(const auto& cur: cfg.succs.at(b)){
             std::cout << get_block_name(cfg, cur) << " ";
         }
         std::cout << std::endl;
@@ -133,7 +524,7 @@ void print_cfg(Cfg cfg){
 
 // get block name (label if it exists, entry if entry node)
 std::string get_block_name(const Cfg& cfg, int block_idx){
-    auto& block = cfg.blocks[block_idx];
+    auto block = cfg.block(block_idx);
     if(block.size() > 0 && block[0].contains("label")){
         return block[0]["label"];
     }
@@ -141,4 +532,365 @@ std::string get_block_name(const Cfg& cfg, int block_idx){
         return "entry";
     }
     return "b" + std::to_string(block_idx);
-}
\ No newline at end of file
+}
+
+// --- typed IR ---
+
+SymbolTable::SymbolTable(const SymbolTable& other) : ids(other.ids) {
+    names.resize(ids.size());
+    for(const auto& [name, id]: ids){
+        names[id] = &name;
+    }
+}
+
+SymbolTable& SymbolTable::operator=(const SymbolTable& other){
+    if(this != &other){
+        SymbolTable copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+SymId SymbolTable::intern(const std::string& name){
+    auto [it, inserted] = ids.try_emplace(name, names.size());
+    if(inserted){
+        names.push_back(&it->first);
+    }
+    return it->second;
+}
+
+SymId SymbolTable::find(const std::string& name) const {
+    auto it = ids.find(name);
+    return it == ids.end() ? NO_SYM : it->second;
+}
+
+static const std::pair<std::string_view,Opcode> opcode_names[] = {
+    {"const", Opcode::Const}, {"id", Opcode::Id}, {"add", Opcode::Add}, {"mul", Opcode::Mul},
+    {"sub", Opcode::Sub}, {"div", Opcode::Div}, {"eq", Opcode::Eq}, {"lt", Opcode::Lt},
+    {"gt", Opcode::Gt}, {"le", Opcode::Le}, {"ge", Opcode::Ge}, {"not", Opcode::Not},
+    {"and", Opcode::And}, {"or", Opcode::Or}, {"jmp", Opcode::Jmp}, {"br", Opcode::Br},
+    {"call", Opcode::Call}, {"ret", Opcode::Ret}, {"print", Opcode::Print}, {"nop", Opcode::Nop},
+    {"fadd", Opcode::Fadd}, {"fmul", Opcode::Fmul}, {"fsub", Opcode::Fsub}, {"fdiv", Opcode::Fdiv},
+    {"feq", Opcode::Feq}, {"flt", Opcode::Flt}, {"fle", Opcode::Fle}, {"fgt", Opcode::Fgt},
+    {"fge", Opcode::Fge}, {"ceq", Opcode::Ceq}, {"clt", Opcode::Clt}, {"cle", Opcode::Cle},
+    {"cgt", Opcode::Cgt}, {"cge", Opcode::Cge}, {"char2int", Opcode::Char2int},
+    {"int2char", Opcode::Int2char}, {"alloc", Opcode::Alloc}, {"free", Opcode::Free},
+    {"store", Opcode::Store}, {"load", Opcode::Load}, {"ptradd", Opcode::Ptradd},
+    {"phi", Opcode::Phi}, {"get", Opcode::Get}, {"set", Opcode::Set}, {"undef", Opcode::Undef},
+    {"speculate", Opcode::Speculate}, {"commit", Opcode::Commit}, {"guard", Opcode::Guard},
+};
+
+Opcode opcode_from_name(std::string_view name){
+    static const std::unordered_map<std::string_view,Opcode> lookup(std::begin(opcode_names), std::end(opcode_names));
+    auto it = lookup.find(name);
+    return it == lookup.end() ? Opcode::Unknown : it->second;
+}
+
+std::string_view opcode_name(Opcode op){
+    for(const auto& [name, cur]: opcode_names){
+        if(cur == op) return name;
+    }
+    return op == Opcode::Label ? "label" : "unknown";
+}
+
+bool is_terminator(Opcode op){
+    return op == Opcode::Jmp || op == Opcode::Br || op == Opcode::Ret;
+}
+
+std::span<const SymId> instr_args(const IrFunc& f, const Instr& instr){
+    return {f.operands.data() + instr.operands, instr.num_args};
+}
+
+std::span<const SymId> instr_labels(const IrFunc& f, const Instr& instr){
+    return {f.operands.data() + instr.operands + instr.num_args, instr.num_labels};
+}
+
+std::span<const SymId> instr_funcs(const IrFunc& f, const Instr& instr){
+    return {f.operands.data() + instr.operands + instr.num_args + instr.num_labels, instr.num_funcs};
+}
+
+std::span<SymId> instr_args(IrFunc& f, const Instr& instr){
+    return {f.operands.data() + instr.operands, instr.num_args};
+}
+
+// bril type to text form, e.g. {"ptr": "int"} -> "ptr<int>"
+static std::string type_to_string(const json& type){
+    if(type.is_object()){
+        return "ptr<" + type_to_string(type["ptr"]) + ">";
+    }
+    return type.get<std::string>();
+}
+
+static json type_from_string(std::string_view type){
+    if(type.starts_with("ptr<")){
+        return json{ {"ptr", type_from_string(type.substr(4, type.size()-5))} };
+    }
+    return std::string(type);
+}
+
+static bool is_modeled_type(const json& type){
+    if(type.is_string()) return true;
+    return type.is_object() && type.size() == 1 && type.contains("ptr") && is_modeled_type(type["ptr"]);
+}
+
+// append a json array of names to the operand list, false if it is not one
+static bool lower_names(const json& names, SymbolTable& table, std::vector<SymId>& operands){
+    if(!names.is_array()) return false;
+    for(const auto& name: names){
+        if(!name.is_string()) return false;
+    }
+    for(const auto& name: names){
+        operands.push_back(table.intern(name.get<std::string>()));
+    }
+    return true;
+}
+
+static Instr lower_instr(const json& j, IrFunc& f){
+    Instr instr;
+    json extra = json::object();
+    instr.operands = f.operands.size();
+
+    if(j.contains("label") && j["label"].is_string()){
+        instr.op = Opcode::Label;
+        instr.dest = f.labels.intern(j["label"].get<std::string>());
+        for(const auto& [key, val]: j.items()){
+            if(key != "label") extra[key] = val;
+        }
+    } else{
+        instr.op = j.contains("op") && j["op"].is_string() ? opcode_from_name(j["op"].get<std::string>()) : Opcode::Unknown;
+
+        for(const auto& [key, val]: j.items()){
+            if(key == "op" && instr.op != Opcode::Unknown){
+                continue;
+            } else if(key == "dest" && val.is_string()){
+                instr.keys |= KEY_DEST;
+                instr.dest = f.vars.intern(val.get<std::string>());
+            } else if(key == "type" && is_modeled_type(val)){
+                instr.keys |= KEY_TYPE;
+                instr.type = f.types.intern(type_to_string(val));
+            } else if(key == "value" && val.is_number_integer() && !val.is_number_unsigned()){
+                instr.value_kind = ValueKind::Int;
+                instr.value.i = val.get<int64_t>();
+            } else if(key == "value" && val.is_number_unsigned()){
+                instr.value_kind = ValueKind::Uint;
+                instr.value.u = val.get<uint64_t>();
+            } else if(key == "value" && val.is_number_float()){
+                instr.value_kind = ValueKind::Float;
+                instr.value.f = val.get<double>();
+            } else if(key == "value" && val.is_boolean()){
+                instr.value_kind = ValueKind::Bool;
+                instr.value.b = val.get<bool>();
+            } else if(key == "value" && val.is_string()){
+                instr.value_kind = ValueKind::Char;
+                instr.value.c = f.strings.intern(val.get<std::string>());
+            } else if(key != "args" && key != "labels" && key != "funcs"){
+                extra[key] = val;
+            }
+        }
+
+        // operands are laid out as args, labels, funcs
+        size_t start = f.operands.size();
+        if(j.contains("args") && lower_names(j["args"], f.vars, f.operands)){
+            instr.keys |= KEY_ARGS;
+            instr.num_args = f.operands.size() - start;
+        } else if(j.contains("args")){
+            extra["args"] = j["args"];
+        }
+        start = f.operands.size();
+        if(j.contains("labels") && lower_names(j["labels"], f.labels, f.operands)){
+            instr.keys |= KEY_LABELS;
+            instr.num_labels = f.operands.size() - start;
+        } else if(j.contains("labels")){
+            extra["labels"] = j["labels"];
+        }
+        start = f.operands.size();
+        if(j.contains("funcs") && lower_names(j["funcs"], f.funcs, f.operands)){
+            instr.keys |= KEY_FUNCS;
+            instr.num_funcs = f.operands.size() - start;
+        } else if(j.contains("funcs")){
+            extra["funcs"] = j["funcs"];
+        }
+    }
+
+    if(!extra.empty()){
+        instr.extra = f.extras.size();
+        f.extras.push_back(std::move(extra));
+    }
+    return instr;
+}
+
+static json raise_names(std::span<const SymId> ids, const SymbolTable& table){
+    json names = json::array();
+    for(SymId id: ids){
+        names.push_back(table.name(id));
+    }
+    return names;
+}
+
+static json raise_instr(const Instr& instr, const IrFunc& f){
+    json j = instr.extra != NO_SYM ? f.extras[instr.extra] : json::object();
+
+    if(instr.op == Opcode::Label){
+        j["label"] = f.labels.name(instr.dest);
+        return j;
+    }
+
+    if(instr.op != Opcode::Unknown) j["op"] = opcode_name(instr.op);
+    if(instr.keys & KEY_DEST) j["dest"] = f.vars.name(instr.dest);
+    if(instr.keys & KEY_TYPE) j["type"] = type_from_string(f.types.name(instr.type));
+    if(instr.keys & KEY_ARGS) j["args"] = raise_names(instr_args(f, instr), f.vars);
+    if(instr.keys & KEY_LABELS) j["labels"] = raise_names(instr_labels(f, instr), f.labels);
+    if(instr.keys & KEY_FUNCS) j["funcs"] = raise_names(instr_funcs(f, instr), f.funcs);
+
+    switch(instr.value_kind){
+        case ValueKind::None: break;
+        case ValueKind::Int: j["value"] = instr.value.i; break;
+        case ValueKind::Uint: j["value"] = instr.value.u; break;
+        case ValueKind::Float: j["value"] = instr.value.f; break;
+        case ValueKind::Bool: j["value"] = instr.value.b; break;
+        case ValueKind::Char: j["value"] = f.strings.name(instr.value.c); break;
+    }
+    return j;
+}
+
+IrFunc lower_func(const json& func){
+    IrFunc f;
+    f.meta = json::object();
+
+    for(const auto& [key, val]: func.items()){
+        if(key == "name" && val.is_string()){
+            f.name = val.get<std::string>();
+        } else if(key == "type" && is_modeled_type(val)){
+            f.ret_type = f.types.intern(type_to_string(val));
+        } else if(key != "instrs" && key != "args"){
+            f.meta[key] = val;
+        }
+    }
+
+    // params are modeled only when they are plain {name, type} pairs
+    if(func.contains("args")){
+        bool plain = func["args"].is_array();
+        for(const auto& arg: func["args"]){
+            plain = plain && arg.is_object() && arg.size() == 2 && arg.contains("name") && arg["name"].is_string()
+                && arg.contains("type") && is_modeled_type(arg["type"]);
+        }
+        if(plain){
+            f.has_args_key = true;
+            for(const auto& arg: func["args"]){
+                f.params.push_back({f.vars.intern(arg["name"].get<std::string>()), f.types.intern(type_to_string(arg["type"]))});
+            }
+        } else{
+            f.meta["args"] = func["args"];
+        }
+    }
+
+    if(func.contains("instrs")){
+        const auto& instrs = func["instrs"];
+        f.instrs.reserve(instrs.size());
+        for(const auto& instr: instrs){
+            f.instrs.push_back(lower_instr(instr, f));
+        }
+    }
+
+    return f;
+}
+
+json raise_func(const IrFunc& f){
+    json func = f.meta;
+    func["name"] = f.name;
+    if(f.ret_type != NO_SYM){
+        func["type"] = type_from_string(f.types.name(f.ret_type));
+    }
+    if(f.has_args_key){
+        json args = json::array();
+        for(const auto& param: f.params){
+            args.push_back(json{
+                {"name", f.vars.name(param.var)},
+                {"type", type_from_string(f.types.name(param.type))}
+            });
+        }
+        func["args"] = args;
+    }
+
+    json instrs = json::array();
+    instrs.get_ref<json::array_t&>().reserve(f.instrs.size());
+    for(const auto& instr: f.instrs){
+        instrs.push_back(raise_instr(instr, f));
+    }
+    func["instrs"] = std::move(instrs);
+    return func;
+}
+
+std::vector<BlockRange> get_block_ranges(const IrFunc& f){
+    std::vector<BlockRange> blocks;
+    int begin = -1;
+
+    bool got_ret = false;
+    for(int i = 0; i < f.instrs.size(); i++){
+        bool is_label = f.instrs[i].op == Opcode::Label;
+        bool is_term = is_terminator(f.instrs[i].op);
+
+        if(got_ret && !is_label) continue;
+        if(is_term) got_ret = true;
+
+        if(is_label){
+            got_ret = false;
+            if(begin != -1) blocks.push_back({begin, i});
+            begin = i;
+        } else if(begin == -1){
+            begin = i;
+        }
+
+        if(is_term){
+            blocks.push_back({begin, i+1});
+            begin = -1;
+        }
+    }
+
+    if(begin != -1){
+        blocks.push_back({begin, (int) f.instrs.size()});
+    }
+
+    return blocks;
+}
+
+
+void sort_vars(IrFunc& f){
+    std::vector<SymId> order(f.vars.size());
+    for(SymId i = 0; i < order.size(); i++){
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](SymId a, SymId b){
+        return f.vars.name(a) < f.vars.name(b);
+    });
+
+    SymbolTable sorted;
+    std::vector<SymId> new_id(order.size());
+    for(SymId i = 0; i < order.size(); i++){
+        new_id[order[i]] = sorted.intern(f.vars.name(order[i]));
+    }
+
+    for(auto& instr: f.instrs){
+        if(instr.keys & KEY_DEST) instr.dest = new_id[instr.dest];
+        for(SymId& arg: instr_args(f, instr)){
+            arg = new_id[arg];
+        }
+    }
+    for(auto& param: f.params){
+        param.var = new_id[param.var];
+    }
+    f.vars = std::move(sorted);
+}
+
+std::span<const Instr> CfgIr::block(int b) const {
+    if(b >= ranges.size()) return {};
+    return {ir.instrs.data() + ranges[b].begin, (size_t) (ranges[b].end - ranges[b].begin)};
+}
+
+CfgIr get_cfg_ir(const json& func){
+    CfgIr cfg_ir;
+    cfg_ir.ir = lower_func(func);
+    sort_vars(cfg_ir.ir);
+    cfg_ir.ranges = get_block_ranges(cfg_ir.ir);
+    return cfg_ir;
+}
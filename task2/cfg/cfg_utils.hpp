@@ -1,7 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <set>
 #include <unordered_map>
@@ -10,22 +16,262 @@
 using json = nlohmann::json;
 using Block = std::vector<json>;
 
+// compressed sparse row adjacency over dense block ids. the targets of row b are
+// edges[start[b], start[b] + len[b]), kept sorted so rows iterate like a std::set<int>.
+// a row that outgrows its capacity is moved to the end of [edges] with room to spare
+class Adjacency {
+public:
+    Adjacency() = default;
+
+    // build [num_nodes] rows from (source, target) pairs in any order; duplicates are dropped
+    Adjacency(int num_nodes, const std::vector<std::pair<int,int>>& edge_list);
+
+    int size() const { return start.size(); }
+    std::span<const int> at(int b) const { return {edges.data() + start[b], (size_t) len[b]}; }
+    std::span<const int> operator[](int b) const { return at(b); }
+    bool contains(int b) const { return 0 <= b && b < size(); }
+    bool has_edge(int b, int t) const;
+
+    // same nodes with every edge reversed
+    Adjacency transpose() const;
+
+    // edit rows in place; spans returned by at() are invalidated
+    int add_node();
+    void insert(int b, int t); // no-op if the edge exists
+    void erase(int b, int t);  // no-op if the edge does not exist
+    void clear(int b);
+
+private:
+    std::vector<int> start;
+    std::vector<int> len;
+    std::vector<int> cap;
+    std::vector<int> edges;
+};
+
+// half-open range of instruction indices forming one basic block
+struct BlockRange {
+    int begin;
+    int end;
+};
+
 struct Cfg {
-    std::unordered_map<int,std::set<int>> preds;
-    std::unordered_map<int,std::set<int>> succs;
+    Adjacency preds;
+    Adjacency succs;
     std::vector<Block> blocks;
     std::vector<int> block_order;
     int entryIdx;
+
+    // block of each label, for cfgs that own their blocks
+    std::unordered_map<std::string,int> label_blocks;
+
+    // set by get_cfg_view instead of [blocks]: block b is (*instrs)[ranges[b]]
+    const std::vector<json>* instrs = nullptr;
+    std::vector<BlockRange> ranges;
+
+    int size() const { return succs.size(); }
+
+    // instructions of block [b], whether the cfg owns its blocks or views the function body
+    std::span<const json> block(int b) const;
+
+    // edges in the direction of an analysis; switching direction copies nothing
+    const Adjacency& successors(bool is_forward) const { return is_forward ? succs : preds; }
+    const Adjacency& predecessors(bool is_forward) const { return is_forward ? preds : succs; }
 };
 
 std::vector<Block> get_blocks(const json& func);
 
+// basic blocks of [func] as ranges into func["instrs"], following the same rules as get_blocks
+std::vector<BlockRange> get_block_ranges(const json& func);
+
 Cfg get_cfg(std::vector<Block> bb);
 
 Cfg get_cfg_func(const json& func);
 
-void print_bb(std::vector<Block> bb);
+// cfg whose blocks are views into func["instrs"]; [func] must outlive it and not be modified
+Cfg get_cfg_view(const json& func);
+
+// move the blocks of [func] out of it, leaving func["instrs"] to be rewritten with write_blocks
+std::vector<Block> take_blocks(json& func);
+
+// cfg owning the blocks moved out of [func]
+Cfg take_cfg(json& func);
+
+// replace the body of [func] by moving in [blocks] in [order]
+void write_blocks(json& func, std::vector<Block>&& blocks, const std::vector<int>& order);
+
+// replace the body of [func] by moving in [blocks] in id order
+void write_blocks(json& func, std::vector<Block>&& blocks);
+
+// --- cfg mutation ---
+// these edit a cfg that owns its blocks, keeping succs, preds, block_order, label_blocks and the
+// jmp/br terminators in step, so the result can be written back with write_blocks(func, blocks, order).
+// edges and terminators are updated in time proportional to the degree of the blocks involved;
+// block_order is a vector, so placing a block in it shifts the blocks after it. deleted blocks keep
+// their id but are left empty, with no edges, and out of block_order
+
+// label of block [b], giving it a fresh label based on [hint] if it has none
+std::string block_label(Cfg& cfg, int b, const std::string& hint = "");
+
+// add an empty block right before [b] in block_order that falls through to [b], and move the edges
+// from each block in [from] to [b] onto it. [label] (made unique) labels the new block; without one
+// it is only labeled if a jump needs it. placed before the entry, it becomes the entry. returns the
+// new block
+int insert_block_before(Cfg& cfg, int b, std::span<const int> from, const std::string& label = "");
+
+// add an empty block on the edge [from] -> [to]; returns the new block
+int split_edge(Cfg& cfg, int from, int to, const std::string& label = "");
+
+// move instructions [at, end) of block [b] into a new block placed right after it, which takes over
+// the successors of [b]; [b] falls through to it. returns the new block
+int split_block(Cfg& cfg, int b, int at, const std::string& label = "");
+
+// make the edge [from] -> [old_to] go to [new_to] instead, retargeting the terminator of [from]
+void redirect_edge(Cfg& cfg, int from, int old_to, int new_to);
+
+// replace the br ending block [b] with a jmp to its successor [target], dropping its other edge
+void fold_branch(Cfg& cfg, int b, int target);
+
+// append block [b] to block [a] and delete [b]; [b] must be the only successor of [a] and [a] the
+// only predecessor of [b]
+void merge_blocks(Cfg& cfg, int a, int b);
+
+// delete block [b], which must not be the entry; edges into it must come only from blocks that are
+// being deleted too
+void delete_block(Cfg& cfg, int b);
+
+// delete every block not reachable from the entry; returns how many were deleted
+int delete_unreachable_blocks(Cfg& cfg);
+
+void print_bb(const std::vector<Block>& bb);
 
-void print_cfg(Cfg cfg);
+void print_cfg(const Cfg& cfg);
+
+std::string get_block_name(const Cfg& cfg, int block_idx);
+
+// --- typed IR ---
+
+enum class Opcode : uint8_t {
+    Label,
+    // core
+    Const, Id, Add, Mul, Sub, Div, Eq, Lt, Gt, Le, Ge, Not, And, Or,
+    Jmp, Br, Call, Ret, Print, Nop,
+    // float
+    Fadd, Fmul, Fsub, Fdiv, Feq, Flt, Fle, Fgt, Fge,
+    // char
+    Ceq, Clt, Cle, Cgt, Cge, Char2int, Int2char,
+    // memory
+    Alloc, Free, Store, Load, Ptradd,
+    // ssa
+    Phi, Get, Set, Undef,
+    // speculation
+    Speculate, Commit, Guard,
+    // op name not known to the IR, kept in the instruction's extras
+    Unknown
+};
+
+using SymId = uint32_t;
+constexpr SymId NO_SYM = UINT32_MAX;
+
+// maps names to dense ids in order of first appearance
+class SymbolTable {
+public:
+    SymbolTable() = default;
+    SymbolTable(const SymbolTable& other);
+    SymbolTable(SymbolTable&& other) = default;
+    SymbolTable& operator=(const SymbolTable& other);
+    SymbolTable& operator=(SymbolTable&& other) = default;
+
+    SymId intern(const std::string& name);
+    SymId find(const std::string& name) const;
+    const std::string& name(SymId id) const { return *names[id]; }
+    size_t size() const { return names.size(); }
+
+private:
+    std::unordered_map<std::string,SymId> ids;
+    std::vector<const std::string*> names; // points at keys of [ids]
+};
+
+// how a const value was spelled in the json, so raising is lossless
+enum class ValueKind : uint8_t { None, Int, Uint, Float, Bool, Char };
+
+// which optional instruction keys were present in the json
+enum InstrKeys : uint8_t {
+    KEY_DEST = 1, KEY_TYPE = 2, KEY_ARGS = 4, KEY_LABELS = 8, KEY_FUNCS = 16
+};
+
+struct Instr {
+    Opcode op;
+    ValueKind value_kind = ValueKind::None;
+    uint8_t keys = 0;
+    uint8_t unused = 0;    // spelled out so binary bril never writes uninitialized padding
+    uint32_t num_args = 0; // counts are as wide as the operand offset, so lowering never truncates
+    uint32_t num_labels = 0;
+    uint32_t num_funcs = 0;
+    SymId dest = NO_SYM;   // var id, or label id if op is Label
+    SymId type = NO_SYM;   // id in IrFunc::types
+    uint32_t operands = 0; // offset of args, then labels, then funcs in IrFunc::operands
+    uint32_t extra = NO_SYM; // index in IrFunc::extras
+    union {
+        int64_t i;
+        uint64_t u;
+        double f;
+        bool b;
+        SymId c; // id in IrFunc::strings
+    } value = {0};
+};
+
+struct IrParam {
+    SymId var;
+    SymId type;
+};
+
+struct IrFunc {
+    std::string name;
+    std::vector<IrParam> params;
+    bool has_args_key = false;
+    SymId ret_type = NO_SYM;
+
+    SymbolTable vars;
+    SymbolTable labels;
+    SymbolTable funcs;
+    SymbolTable types;   // bril text form, e.g. "int" or "ptr<int>"
+    SymbolTable strings; // char values
+
+    std::vector<Instr> instrs;
+    std::vector<SymId> operands;
+
+    json meta;               // function keys the IR does not model
+    std::vector<json> extras; // instruction keys the IR does not model
+};
+
+Opcode opcode_from_name(std::string_view name);
+std::string_view opcode_name(Opcode op);
+bool is_terminator(Opcode op);
+
+// operand views of an instruction
+std::span<const SymId> instr_args(const IrFunc& f, const Instr& instr);
+std::span<const SymId> instr_labels(const IrFunc& f, const Instr& instr);
+std::span<const SymId> instr_funcs(const IrFunc& f, const Instr& instr);
+std::span<SymId> instr_args(IrFunc& f, const Instr& instr);
+
+// lower a bril json function to the IR and raise it back; raise(lower(f)) == f
+IrFunc lower_func(const json& func);
+json raise_func(const IrFunc& f);
+
+// basic blocks of [f] as ranges, following the same rules as get_blocks
+std::vector<BlockRange> get_block_ranges(const IrFunc& f);
+
+// renumber variables so their ids follow name order; id-ordered sets then iterate like sets of names
+void sort_vars(IrFunc& f);
+
+// lowered function whose blocks line up with get_cfg_func: cfg.blocks[b][k] is block(b)[k]
+struct CfgIr {
+    IrFunc ir;
+    std::vector<BlockRange> ranges;
+
+    // instructions of block [b]; blocks added by get_cfg (the empty entry) have none
+    std::span<const Instr> block(int b) const;
+};
 
-std::string get_block_name(const Cfg& cfg, int block_idx);
\ No newline at end of file
+// lower [func] with variables sorted by name
+CfgIr get_cfg_ir(const json& func);
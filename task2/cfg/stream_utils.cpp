@@ -0,0 +1,240 @@
+#include "stream_utils.hpp"
+#include "bin_utils.hpp"
+#include "thread_pool.hpp"
+
+#include <deque>
+#include <future>
+#include <optional>
+
+#include <unistd.h>
+
+// sax handler that builds each element of the top-level "functions" array as its own json value and
+// hands it off when it is complete; everything else is built into [rest]
+class FuncSax {
+public:
+    explicit FuncSax(const std::function<void(json&)>& on_func) : on_func(on_func) {}
+
+    json rest;
+
+    bool null() { put(nullptr); return true; }
+    bool boolean(bool val) { put(val); return true; }
+    bool number_integer(json::number_integer_t val) { put(val); return true; }
+    bool number_unsigned(json::number_unsigned_t val) { put(val); return true; }
+    bool number_float(json::number_float_t val, const json::string_t&) { put(val); return true; }
+    bool string(json::string_t& val) { put(std::move(val)); return true; }
+    bool binary(json::binary_t& val) { put(json::binary(std::move(val))); return true; }
+
+    bool start_object(std::size_t) { stack.push_back(put(json::object())); return true; }
+    bool start_array(std::size_t) { stack.push_back(put(json::array())); return true; }
+
+    bool key(json::string_t& val){
+        if(stack.size() == 1 && val == "functions"){
+            slot = &functions;
+        } else {
+            slot = &(*stack.back())[val];
+        }
+        return true;
+    }
+
+    bool end_object(){
+        stack.pop_back();
+        if(!stack.empty() && stack.back() == &functions){
+            on_func(func);
+            func = json();
+        }
+        return true;
+    }
+
+    bool end_array(){
+        stack.pop_back();
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const json::exception& ex){
+        if(auto parse_ex = dynamic_cast<const json::parse_error*>(&ex)){
+            throw *parse_ex;
+        }
+        return false;
+    }
+
+private:
+    const std::function<void(json&)>& on_func;
+    std::vector<json*> stack; // containers being built, innermost last
+    json* slot = nullptr;     // value of the last key seen in the innermost object
+    json functions;           // stands in for the functions array, which is never built
+    json func;                // function being built
+
+    // place [val] in the innermost container and return where it went
+    json* put(json&& val){
+        if(stack.empty()){
+            rest = std::move(val);
+            return &rest;
+        }
+        json* top = stack.back();
+        if(top == &functions){
+            func = std::move(val);
+            return &func;
+        }
+        if(top->is_array()){
+            top->push_back(std::move(val));
+            return &top->back();
+        }
+        *slot = std::move(val);
+        return slot;
+    }
+};
+
+BrilFormat sniff_format(std::istream& in){
+    return in.peek() == BIN_MAGIC[0] ? BrilFormat::Binary : BrilFormat::Json;
+}
+
+json for_each_func(std::istream& in, const std::function<void(json&)>& on_func){
+    if(sniff_format(in) == BrilFormat::Binary){
+        auto raise = [&](IrFunc& f){
+            json func = raise_func(f);
+            on_func(func);
+        };
+
+        // read a redirected file in place, a pipe chunk by chunk
+        if(&in == &std::cin){
+            MappedFile file(STDIN_FILENO);
+            if(!file.empty()){
+                return for_each_bin_func(file.bytes(), raise);
+            }
+        }
+        return for_each_bin_func(in, raise);
+    }
+
+    FuncSax sax(on_func);
+    json::sax_parse(in, &sax);
+    return sax.rest;
+}
+
+// writes a program one function at a time in a given format
+class ProgramWriter {
+public:
+    ProgramWriter(std::ostream& out, BrilFormat format) : out(out) {
+        if(format == BrilFormat::Binary){
+            bin.emplace(out);
+        } else {
+            out << "{\"functions\":[";
+        }
+    }
+
+    void write(const json& func){
+        if(bin){
+            bin->write_func(lower_func(func));
+            return;
+        }
+        if(!first) out << ",";
+        out << func << std::flush;
+        first = false;
+    }
+
+    // write the other top-level keys and close the program
+    void finish(const json& rest){
+        if(bin){
+            bin->finish(rest);
+            return;
+        }
+        out << "]";
+
+        // other top-level keys follow the functions
+        if(rest.is_object()){
+            for(const auto& [key, val]: rest.items()){
+                out << "," << json(key) << ":" << val;
+            }
+        }
+        out << "}";
+    }
+
+private:
+    std::ostream& out;
+    std::optional<BinWriter> bin;
+    bool first = true;
+};
+
+void transform_funcs(std::istream& in, std::ostream& out, BrilFormat out_format, const std::function<void(json&)>& on_func, int jobs){
+    ProgramWriter writer(out, out_format);
+    if(jobs <= 1){
+        json rest = for_each_func(in, [&](json& func){
+            on_func(func);
+            writer.write(func);
+        });
+        writer.finish(rest);
+        return;
+    }
+
+    // functions handed to the pool, in input order; the front one is written as soon as it is done
+    struct Slot {
+        json func;
+        std::promise<void> done;
+        std::future<void> ready = done.get_future();
+    };
+    std::deque<std::unique_ptr<Slot>> window;
+    const size_t max_in_flight = 4 * jobs;
+
+    auto write_front = [&](){
+        window.front()->ready.get(); // rethrows what on_func threw
+        writer.write(window.front()->func);
+        window.pop_front();
+    };
+    auto front_done = [&](){
+        return window.front()->ready.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
+
+    // declared after the window so that it finishes its tasks before their slots go away
+    ThreadPool pool(jobs);
+    json rest = for_each_func(in, [&](json& func){
+        auto slot = std::make_unique<Slot>();
+        slot->func = std::move(func);
+        pool.submit([s = slot.get(), &on_func](){
+            try {
+                on_func(s->func);
+                s->done.set_value();
+            } catch (...) {
+                s->done.set_exception(std::current_exception());
+            }
+        });
+        window.push_back(std::move(slot));
+
+        // bound the functions held in memory while the parser runs ahead
+        while(!window.empty() && (window.size() >= max_in_flight || front_done())){
+            write_front();
+        }
+    });
+    while(!window.empty()){
+        write_front();
+    }
+    writer.finish(rest);
+}
+
+void transform_funcs(std::istream& in, std::ostream& out, const std::function<void(json&)>& on_func, int jobs){
+    transform_funcs(in, out, sniff_format(in), on_func, jobs);
+}
+
+int take_jobs_arg(int& argc, char* argv[]){
+    int jobs = 1;
+    for(int i = 1; i < argc; i++){
+        if(std::string(argv[i]) != "-j") continue;
+        if(i + 1 == argc){
+            throw std::invalid_argument("-j needs a number of threads");
+        }
+        try {
+            jobs = std::stoi(argv[i + 1]);
+        } catch (const std::exception&) {
+            jobs = 0;
+        }
+        if(jobs < 1){
+            throw std::invalid_argument(std::string("invalid number of threads ") + argv[i + 1]);
+        }
+
+        // shift the remaining args over the option
+        for(int j = i + 2; j <= argc; j++){
+            argv[j - 2] = argv[j];
+        }
+        argc -= 2;
+        i--;
+    }
+    return jobs;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+enum class BrilFormat { Json, Binary };
+
+// format of the program waiting in [in], told apart by the binary magic header; consumes nothing
+BrilFormat sniff_format(std::istream& in);
+
+// read the bril program in [in], json or binary, one function at a time: [on_func] gets each
+// function as soon as it has been parsed, so only one function is held in memory. a binary program
+// on a regular-file stdin is mmapped. returns the program's other top-level keys.
+// throws json::parse_error on malformed json and std::runtime_error on malformed binary
+json for_each_func(std::istream& in, const std::function<void(json&)>& on_func);
+
+// like for_each_func, but each function is written to [out] in [out_format] as soon as [on_func]
+// has rewritten it; the output is the whole rewritten program. with [jobs] > 1, [on_func] runs on
+// that many functions at once on a thread pool, so it must only touch the function it is given;
+// functions are still written in input order and the output is byte-for-byte the serial one
+void transform_funcs(std::istream& in, std::ostream& out, BrilFormat out_format, const std::function<void(json&)>& on_func, int jobs = 1);
+
+// same, writing the format the input was in
+void transform_funcs(std::istream& in, std::ostream& out, const std::function<void(json&)>& on_func, int jobs = 1);
+
+// remove a "-j N" option from the command line and return N, or 1 if there is none;
+// throws std::invalid_argument if N is not a positive number
+int take_jobs_arg(int& argc, char* argv[]);
@@ -0,0 +1,77 @@
+#include "thread_pool.hpp"
+
+// index of the pool worker running on this thread, -1 elsewhere
+static thread_local int worker_index = -1;
+
+ThreadPool::ThreadPool(int num_threads){
+    for(int i = 0; i < num_threads; i++){
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    for(int i = 0; i < num_threads; i++){
+        threads.emplace_back([this, i]{ work(i); });
+    }
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> guard(wake_lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(auto& thread: threads){
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task){
+    int q = worker_index >= 0 ? worker_index : next_queue++ % queues.size();
+    {
+        // count the task before any worker can take it, so queued never drops below zero, and
+        // under wake_lock so a sleeping worker never sees the count without the task
+        std::lock_guard<std::mutex> wake_guard(wake_lock);
+        queued++;
+        std::lock_guard<std::mutex> guard(queues[q]->lock);
+        queues[q]->tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+// newest task of our own deque
+bool ThreadPool::pop(int self, std::function<void()>& task){
+    auto& q = *queues[self];
+    std::lock_guard<std::mutex> guard(q.lock);
+    if(q.tasks.empty()) return false;
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+}
+
+// oldest task of the first other deque that has one
+bool ThreadPool::steal(int self, std::function<void()>& task){
+    for(int i = 1; i < queues.size(); i++){
+        auto& q = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if(q.tasks.empty()) continue;
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::work(int self){
+    worker_index = self;
+    while(true){
+        std::function<void()> task;
+        if(pop(self, task) || steal(self, task)){
+            queued--;
+            task();
+            continue;
+        }
+
+        // sleep until there is work, or until told to stop with nothing left
+        std::unique_lock<std::mutex> guard(wake_lock);
+        wake.wait(guard, [&]{ return queued > 0 || stopping; });
+        if(stopping && queued == 0) return;
+    }
+}
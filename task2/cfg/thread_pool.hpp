@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads, each with its own task deque. a worker runs its own tasks newest
+// first and, once it runs out, steals the oldest task of another worker, so a few long functions
+// do not hold up the short ones queued behind them
+class ThreadPool {
+public:
+    explicit ThreadPool(int num_threads);
+
+    // runs every task already submitted, then joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // queue [task]; from a worker it goes on that worker's own deque, otherwise round robin
+    void submit(std::function<void()> task);
+
+    int size() const { return threads.size(); }
+
+private:
+    struct TaskQueue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> next_queue = 0;
+
+    std::mutex wake_lock;
+    std::condition_variable wake;
+    std::atomic<size_t> queued = 0; // submitted but not yet taken by a worker
+    bool stopping = false;          // guarded by wake_lock
+
+    bool pop(int self, std::function<void()>& task);
+    bool steal(int self, std::function<void()>& task);
+    void work(int self);
+};
@@ -0,0 +1,148 @@
+#include "dce_utils.hpp"
+
+// one pass to remove unused var names
+bool remove_unused_var(IrFunc& f){
+    // find all used vars
+    std::vector<bool> seen(f.vars.size());
+    for(const auto& instr: f.instrs){
+        for(SymId arg: instr_args(f, instr)){
+            seen[arg] = true;
+        }
+    }
+
+    // remove any unused assigns
+    auto& instrs = f.instrs;
+    auto it = std::remove_if(instrs.begin(), instrs.end(), [&](const Instr& instr){
+        return (instr.keys & KEY_DEST) && !seen[instr.dest];
+    });
+    bool found_opt = it != instrs.end();
+    instrs.erase(it, instrs.end());
+    return found_opt;
+}
+
+// one pass to remove values overwritten before read
+bool remove_local_killed(IrFunc& f){
+    bool found_opt = false;
+
+    // per var: index of last def in the current block, and whether it was read since
+    std::vector<int> last_def(f.vars.size(), -1);
+    std::vector<bool> used(f.vars.size());
+    std::vector<SymId> touched;
+
+    std::vector<Instr> new_instrs;
+    new_instrs.reserve(f.instrs.size());
+    for(const auto& b: get_block_ranges(f)){
+        std::set<int> invalid;
+
+        for(int i = b.begin; i < b.end; i++){
+            auto& instr = f.instrs[i];
+
+            // process usages (args)
+            for(SymId arg: instr_args(f, instr)){
+                if(last_def[arg] != -1){
+                    used[arg] = true;
+                }
+            }
+
+            // write new dest usage
+            if(instr.keys & KEY_DEST){
+                SymId dest = instr.dest;
+                if(last_def[dest] != -1 && !used[dest]){
+                    invalid.insert(last_def[dest]);
+                } else if(last_def[dest] == -1){
+                    touched.push_back(dest);
+                }
+                last_def[dest] = i;
+                used[dest] = false;
+            }
+        }
+
+        // keep instructions that are not overwritten
+        for(int i = b.begin; i < b.end; i++){
+            if(!invalid.count(i)) new_instrs.push_back(f.instrs[i]);
+        }
+        found_opt |= !invalid.empty();
+
+        for(SymId var: touched){
+            last_def[var] = -1;
+        }
+        touched.clear();
+    }
+
+    // update function body
+    f.instrs = std::move(new_instrs);
+
+    return found_opt;
+}
+
+// tdce with iteration to convergence
+void tdce(json& func){
+    IrFunc f = lower_func(func);
+    bool changed = true;
+    while(changed){
+        changed = remove_unused_var(f) || remove_local_killed(f);
+    }
+    func = raise_func(f);
+}
+
+// drop the defs of block [b] whose var is not live after them, walking back from its live-out
+// vars; a dropped def no longer reads its args, so the defs of those can die in the same walk.
+// calls are kept for their side effects. dropped instructions are left as nops that define and
+// read nothing. true if any was dropped
+static bool remove_dead_defs(CfgIr& cfg_ir, const BitFacts& live, int b, std::vector<bool>& removed){
+    IrFunc& f = cfg_ir.ir;
+    if(b >= cfg_ir.ranges.size()) return false;
+
+    BitVector facts = live.first[b];
+    bool found_opt = false;
+    for(int i = cfg_ir.ranges[b].end - 1; i >= cfg_ir.ranges[b].begin; i--){
+        Instr& instr = f.instrs[i];
+        if(removed[i]) continue;
+        if((instr.keys & KEY_DEST) && !facts.test(instr.dest) && instr.op != Opcode::Call){
+            instr = Instr{Opcode::Nop};
+            removed[i] = true;
+            found_opt = true;
+            continue;
+        }
+
+        if(instr.keys & KEY_DEST){
+            facts.reset(instr.dest);
+        }
+        for(SymId arg: instr_args(f, instr)){
+            facts.set(arg);
+        }
+    }
+    return found_opt;
+}
+
+void live_dce(json& func){
+    Cfg cfg = get_cfg_view(func);
+    CfgIr cfg_ir = get_cfg_ir(func);
+    IrFunc& f = cfg_ir.ir;
+    BitFacts live = df_live_bits(cfg, cfg_ir);
+
+    std::vector<bool> removed(f.instrs.size());
+    std::vector<int> todo(cfg.size());
+    std::iota(todo.begin(), todo.end(), 0);
+    while(!todo.empty()){
+        std::vector<int> dirty;
+        for(int b: todo){
+            if(remove_dead_defs(cfg_ir, live, b, removed)) dirty.push_back(b);
+        }
+        if(dirty.empty()) break;
+        todo = df_live_bits_update(cfg, cfg_ir, live, dirty);
+    }
+
+    // keep what is left of the blocks; code after a terminator that no label starts is dropped too
+    std::vector<Instr> new_instrs;
+    new_instrs.reserve(f.instrs.size());
+    for(const auto& range: cfg_ir.ranges){
+        for(int i = range.begin; i < range.end; i++){
+            if(!removed[i]) new_instrs.push_back(f.instrs[i]);
+        }
+    }
+
+    // update function body
+    f.instrs = std::move(new_instrs);
+    func = raise_func(f);
+}
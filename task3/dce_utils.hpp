@@ -0,0 +1,24 @@
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cassert>
+#include <set>
+#include <map>
+#include <numeric>
+#include <utility>
+#include <nlohmann/json.hpp>
+
+#include "../task2/cfg/cfg_utils.hpp"
+#include "../task4/dataflow_utils.hpp"
+
+// trivial dead code elimination of [func], iterated to convergence
+void tdce(json& func);
+
+// dead code elimination of [func] by liveness: drops every def whose var is not live after it, so
+// also defs overwritten on every path or read only by dead code. liveness is solved once, then
+// re-solved only from the blocks that lost defs, and only blocks whose live-out vars changed are
+// looked at again, so it costs about as much as what it removes
+void live_dce(json& func);
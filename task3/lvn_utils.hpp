@@ -0,0 +1,15 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <set>
+#include <unordered_map>
+#include <format>
+#include <cassert>
+#include <nlohmann/json.hpp>
+
+#include "../task2/cfg/cfg_utils.hpp"
+
+// local value numbering of each block of [func]; leaves dead copies for tdce to clean up
+void lvn(json& func);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+// dense fixed-size set of bit positions, stored as 64-bit words so that unions and gen/kill transfers
+// work a word at a time
+class BitVector {
+public:
+    BitVector() = default;
+    explicit BitVector(int num_bits) : num_bits(num_bits), words((num_bits + 63) / 64) {}
+
+    int size() const { return num_bits; }
+
+    bool test(int i) const { return words[i / 64] >> (i % 64) & 1; }
+    void set(int i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+    void reset(int i) { words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+
+    bool operator==(const BitVector& other) const = default;
+
+    // this |= other; true if a bit was added
+    bool merge(const BitVector& other){
+        uint64_t added = 0;
+        for(int w = 0; w < words.size(); w++){
+            added |= other.words[w] & ~words[w];
+            words[w] |= other.words[w];
+        }
+        return added != 0;
+    }
+
+    // this = gen | (in & ~kill); true if this changed
+    bool transfer(const BitVector& in, const BitVector& gen, const BitVector& kill){
+        uint64_t changed = 0;
+        for(int w = 0; w < words.size(); w++){
+            uint64_t cur = gen.words[w] | (in.words[w] & ~kill.words[w]);
+            changed |= words[w] ^ cur;
+            words[w] = cur;
+        }
+        return changed != 0;
+    }
+
+    // call [fn] on each set bit position, in increasing order
+    template<typename F>
+    void for_each(F fn) const {
+        for(int w = 0; w < words.size(); w++){
+            for(uint64_t bits = words[w]; bits; bits &= bits - 1){
+                fn(w * 64 + std::countr_zero(bits));
+            }
+        }
+    }
+
+private:
+    int num_bits = 0;
+    std::vector<uint64_t> words;
+};
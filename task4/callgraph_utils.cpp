@@ -0,0 +1,234 @@
+#include "callgraph_utils.hpp"
+
+#include <atomic>
+#include <exception>
+#include <latch>
+#include <mutex>
+#include <unordered_set>
+
+#include "../task2/cfg/thread_pool.hpp"
+
+CallGraph get_call_graph(const json& functions){
+    CallGraph cg;
+    for(const auto& func: functions){
+        std::string name = func["name"];
+        cg.ids.emplace(name, cg.names.size());
+        cg.names.push_back(name);
+    }
+
+    std::vector<std::pair<int,int>> edges;
+    for(int f = 0; f < functions.size(); f++){
+        if(!functions[f].contains("instrs")) continue;
+        for(const auto& instr: functions[f]["instrs"]){
+            if(!instr.contains("funcs")) continue;
+            for(const auto& callee: instr["funcs"]){
+                auto it = cg.ids.find(callee.get<std::string>());
+                if(it != cg.ids.end()) edges.push_back({f, it->second});
+            }
+        }
+    }
+    cg.callees = Adjacency(cg.names.size(), edges);
+    return cg;
+}
+
+// tarjan's algorithm, which finishes a component only after every component it reaches
+std::vector<std::vector<int>> call_graph_sccs(const CallGraph& cg){
+    int n = cg.names.size();
+    std::vector<int> index(n, -1);
+    std::vector<int> low(n);
+    std::vector<bool> on_stack(n);
+    std::vector<int> stack;
+    std::vector<std::vector<int>> sccs;
+    int next_index = 0;
+
+    auto visit = [&](int f){
+        index[f] = low[f] = next_index++;
+        stack.push_back(f);
+        on_stack[f] = true;
+    };
+
+    // iterative dfs; a function is finished once all its callees are
+    std::vector<std::pair<int,int>> dfs; // function and index of the next callee to visit
+    for(int root = 0; root < n; root++){
+        if(index[root] != -1) continue;
+        visit(root);
+        dfs.push_back({root, 0});
+        while(!dfs.empty()){
+            auto [f, next] = dfs.back();
+            auto callees = cg.callees.at(f);
+            if(next < callees.size()){
+                dfs.back().second++;
+                int g = callees[next];
+                if(index[g] == -1){
+                    visit(g);
+                    dfs.push_back({g, 0});
+                } else if(on_stack[g]){
+                    low[f] = std::min(low[f], index[g]);
+                }
+                continue;
+            }
+
+            // f roots a component: everything above it on the stack
+            if(low[f] == index[f]){
+                std::vector<int> scc;
+                int g;
+                do {
+                    g = stack.back();
+                    stack.pop_back();
+                    on_stack[g] = false;
+                    scc.push_back(g);
+                } while(g != f);
+                sccs.push_back(std::move(scc));
+            }
+            dfs.pop_back();
+            if(!dfs.empty()){
+                int caller = dfs.back().first;
+                low[caller] = std::min(low[caller], low[f]);
+            }
+        }
+    }
+    return sccs;
+}
+
+// summary of [func] given the summaries of its [callees] outside its [component]; calls within the
+// component have no summary yet and do not count for side effects, which the caller merges
+static FuncSummary summarize_function(const json& func, const FuncSummaries& callees, const std::unordered_set<std::string>& component){
+    Cfg cfg = get_cfg_view(func);
+    CfgIr cfg_ir = get_cfg_ir(func);
+    const IrFunc& f = cfg_ir.ir;
+    FuncSummary summary;
+
+    // a param is used if it is live into the function
+    BitFacts live = df_live_bits(cfg, cfg_ir, nullptr, &callees);
+    for(const auto& param: f.params){
+        summary.used_args.push_back(cfg.size() > 0 && live.second[cfg.entryIdx].test(param.var));
+    }
+
+    // the return value is constant if every ret returns the same constant at the end of its block
+    auto [in, out] = df_const_propagation(func, false, nullptr, &callees);
+    bool ret_const = false;
+    for(int b = 0; b < cfg.size(); b++){
+        auto block = cfg_ir.block(b);
+        if(block.empty() || block.back().op != Opcode::Ret) continue;
+        auto args = instr_args(f, block.back());
+        auto it = args.empty() ? out[b].end() : out[b].find(f.vars.name(args[0]));
+        if(it == out[b].end() || !it->second || (ret_const && summary.ret_value != it->second)){
+            ret_const = false;
+            summary.ret_value = std::nullopt;
+            break;
+        }
+        ret_const = true;
+        summary.ret_value = it->second;
+    }
+
+    summary.has_side_effects = false;
+    for(const auto& instr: f.instrs){
+        switch(instr.op){
+            case Opcode::Store:
+            case Opcode::Print:
+            case Opcode::Free:
+            case Opcode::Unknown:
+                summary.has_side_effects = true;
+                break;
+            case Opcode::Call: {
+                auto funcs = instr_funcs(f, instr);
+                if(funcs.empty()) break;
+                const std::string& name = f.funcs.name(funcs[0]);
+                if(component.contains(name)) break;
+                auto it = callees.find(name);
+                summary.has_side_effects |= it == callees.end() || it->second.has_side_effects;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    return summary;
+}
+
+FuncSummaries summarize_functions(const json& functions, int jobs){
+    CallGraph cg = get_call_graph(functions);
+    std::vector<std::vector<int>> sccs = call_graph_sccs(cg);
+
+    // condense the call graph to its components
+    std::vector<int> comp_of(cg.names.size());
+    for(int c = 0; c < sccs.size(); c++){
+        for(int f: sccs[c]) comp_of[f] = c;
+    }
+    std::vector<std::pair<int,int>> comp_edges;
+    for(int f = 0; f < cg.names.size(); f++){
+        for(int g: cg.callees.at(f)){
+            if(comp_of[f] != comp_of[g]) comp_edges.push_back({comp_of[f], comp_of[g]});
+        }
+    }
+    Adjacency comp_callees(sccs.size(), comp_edges);
+    Adjacency comp_callers = comp_callees.transpose();
+
+    // each component only writes the summaries of its own functions and only reads those of
+    // components it waited for
+    std::vector<FuncSummary> summaries(cg.names.size());
+    auto summarize_scc = [&](int c){
+        FuncSummaries callees;
+        std::unordered_set<std::string> component;
+        for(int f: sccs[c]){
+            component.insert(cg.names[f]);
+            for(int g: cg.callees.at(f)){
+                if(comp_of[g] != c) callees[cg.names[g]] = summaries[g];
+            }
+        }
+
+        // every function of a component can reach every other, so they share side effects
+        bool has_side_effects = false;
+        for(int f: sccs[c]){
+            summaries[f] = summarize_function(functions[f], callees, component);
+            has_side_effects |= summaries[f].has_side_effects;
+        }
+        for(int f: sccs[c]){
+            summaries[f].has_side_effects = has_side_effects;
+        }
+    };
+
+    if(jobs <= 1){
+        for(int c = 0; c < sccs.size(); c++){
+            summarize_scc(c);
+        }
+    } else {
+        // a component is queued once the last component it calls is done
+        std::vector<std::atomic<int>> waiting(sccs.size());
+        for(int c = 0; c < sccs.size(); c++){
+            waiting[c] = comp_callees.at(c).size();
+        }
+        std::latch done(sccs.size());
+        std::mutex error_lock;
+        std::exception_ptr error;
+
+        // declared before the pool so that it outlives the tasks still returning from it
+        std::function<void(int)> run;
+        ThreadPool pool(jobs);
+        run = [&](int c){
+            try {
+                summarize_scc(c);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(error_lock);
+                if(!error) error = std::current_exception();
+            }
+            for(int caller: comp_callers.at(c)){
+                if(waiting[caller].fetch_sub(1) == 1){
+                    pool.submit([&run, caller](){ run(caller); });
+                }
+            }
+            done.count_down();
+        };
+        for(int c = 0; c < sccs.size(); c++){
+            if(waiting[c] == 0) pool.submit([&run, c](){ run(c); });
+        }
+        done.wait();
+        if(error) std::rethrow_exception(error);
+    }
+
+    FuncSummaries named;
+    for(int f = 0; f < cg.names.size(); f++){
+        named[cg.names[f]] = std::move(summaries[f]);
+    }
+    return named;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "../task2/cfg/cfg_utils.hpp"
+#include "dataflow_utils.hpp"
+
+// functions of a program by index in j["functions"], with an edge from each to every function it
+// calls; calls to functions not in the program have no edge
+struct CallGraph {
+    std::vector<std::string> names;
+    std::unordered_map<std::string, int> ids;
+    Adjacency callees;
+};
+
+CallGraph get_call_graph(const json& functions);
+
+// strongly connected components of [cg], callees first: the functions a component calls are in it
+// or in an earlier one
+std::vector<std::vector<int>> call_graph_sccs(const CallGraph& cg);
+
+// summary of each function of j["functions"], made bottom up over the components of the call graph:
+// a function is analyzed with the summaries of the callees outside its component, and calls within
+// its component are opaque. components that do not wait on each other run at once on [jobs] threads
+FuncSummaries summarize_functions(const json& functions, int jobs = 1);
@@ -1,39 +1,111 @@
 #include "dataflow_utils.hpp"
+#include "callgraph_utils.hpp"
+#include "../task2/cfg/stream_utils.hpp"
+
+static void print_summary(const json& func, const FuncSummary& summary){
+    std::vector<std::string> used, unused;
+    if(func.contains("args")){
+        for(int i = 0; i < func["args"].size(); i++){
+            (summary.used_args[i] ? used : unused).push_back(func["args"][i]["name"]);
+        }
+    }
+    auto print_names = [](const std::vector<std::string>& names){
+        if(names.empty()) std::cout << "∅";
+        for(int i = 0; i < names.size(); i++){
+            std::cout << (i ? ", " : "") << names[i];
+        }
+        std::cout << std::endl;
+    };
+
+    std::cout << func["name"].get<std::string>() << ":" << std::endl;
+    std::cout << "  used args:    ";
+    print_names(used);
+    std::cout << "  unused args:  ";
+    print_names(unused);
+    std::cout << "  returns:      ";
+    if(!summary.ret_value) std::cout << "?";
+    else std::visit([](auto&& val) { std::cout << val; }, *summary.ret_value);
+    std::cout << std::endl;
+    std::cout << "  side effects: " << (summary.has_side_effects ? "yes" : "no") << std::endl;
+}
 
 int main(int argc, char* argv[]) {
-    // get df type
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <defined|live|reaching|constprop>" << std::endl;
+    // number of threads summarizing functions
+    int jobs;
+    try {
+        jobs = take_jobs_arg(argc, argv);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
         return 1;
     }
-    std::string df_type = argv[1];
 
-    // open bril json
-    json j;
-    try {
-        std::cin >> j;
-    } catch (const json::parse_error& e) {
-        std::cerr << "ERROR: Failed to parse JSON from stdin, " << e.what() << std::endl;
+    // get df type and flags
+    bool show_stats = false;
+    bool use_summaries = false;
+    bool bad_flag = false;
+    for (int i = 2; i < argc; i++) {
+        std::string flag = argv[i];
+        if (flag == "--stats") show_stats = true;
+        else if (flag == "--summaries") use_summaries = true;
+        else bad_flag = true;
+    }
+    if (argc < 2 || bad_flag) {
+        std::cerr << "Usage: " << argv[0] << " <defined|live|reaching|constprop|summary> [--stats] [--summaries] [-j N]" << std::endl;
         return 1;
     }
-    
-    // do analysis
-    for(auto& func: j["functions"]){
+    std::string df_type = argv[1];
+    if(df_type != "defined" && df_type != "live" && df_type != "reaching" && df_type != "constprop" && df_type != "summary"){
+        std::cout << "ERROR: Unknown df type, got " << df_type << std::endl;
+        return 1;
+    }
+
+    auto analyze = [&](json& func, const FuncSummaries* summaries){
         // std::cout << "analyzing func: " << func["name"] << std::endl;
+        DFStats stats;
         if(df_type == "defined"){
-            df_defined_vars(func, true);
+            df_defined_vars(func, true, &stats);
         } else if(df_type == "live"){
-            df_live_vars(func, true);
+            df_live_vars(func, true, &stats, summaries);
         } else if(df_type == "reaching"){
-            df_reaching_defs(func, true);
-        } else if (df_type == "constprop") {
-            df_const_propagation(func, true);
-        } else{
-            std::cout << "ERROR: Unknown df type, got " << df_type << std::endl;
-            return 1;
+            df_reaching_defs(func, true, &stats);
+        } else {
+            df_const_propagation(func, true, &stats, summaries);
         }
         std::cout << std::endl;
+
+        // convergence on stderr, so the analysis output stays comparable
+        if(show_stats){
+            std::cerr << func["name"].get<std::string>() << ": " << stats.visits << " visits, "
+                      << stats.transfers << " transfers" << std::endl;
+        }
+    };
+
+    try {
+        // do analysis on each function as it is read
+        if(!use_summaries && df_type != "summary"){
+            for_each_func(std::cin, [&](json& func){ analyze(func, nullptr); });
+            return 0;
+        }
+
+        // summaries need the whole program
+        json functions = json::array();
+        for_each_func(std::cin, [&](json& func){ functions.push_back(std::move(func)); });
+        FuncSummaries summaries = summarize_functions(functions, jobs);
+        for(auto& func: functions){
+            if(df_type == "summary"){
+                print_summary(func, summaries[func["name"]]);
+                std::cout << std::endl;
+            } else {
+                analyze(func, &summaries);
+            }
+        }
+    } catch (const json::parse_error& e) {
+        std::cerr << "ERROR: Failed to parse JSON from stdin, " << e.what() << std::endl;
+        return 1;
+    } catch (const std::runtime_error& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,68 +1,219 @@
 #include "dataflow_utils.hpp"
 
-// get names of variables written to in block [b]
-std::set<std::string> get_defs(const Block& b){
-    std::set<std::string> defs;
-    for(auto& instr: b){
-        if(instr.contains("dest")){
-            defs.insert(instr["dest"]);
+// blocks in reverse postorder from the entry for a forward problem, postorder for a backward one,
+// so that most blocks are visited after the blocks they take facts from. unreachable blocks go last
+static std::vector<int> df_order(const Cfg& cfg, bool is_forward){
+    std::vector<int> order;
+    std::vector<bool> visited(cfg.size());
+
+    // iterative dfs; a block is finished once all its successors are pushed and done
+    std::vector<std::pair<int,int>> stack; // block and index of the next successor to visit
+    if(cfg.size() > 0){
+        stack.push_back({cfg.entryIdx, 0});
+        visited[cfg.entryIdx] = true;
+    }
+    while(!stack.empty()){
+        auto& [b, next] = stack.back();
+        auto succs = cfg.succs.at(b);
+        if(next < succs.size()){
+            int s = succs[next++];
+            if(!visited[s]){
+                visited[s] = true;
+                stack.push_back({s, 0});
+            }
+            continue;
         }
+        order.push_back(b);
+        stack.pop_back();
+    }
+    if(is_forward){
+        std::reverse(order.begin(), order.end());
     }
-    return defs;
-}
 
-template<typename T, typename M, typename R, typename D>
-std::pair<std::unordered_map<int, T>, std::unordered_map<int, T>>  df_worklist(const json& func, bool is_forward, T init, M merge, R transfer, bool is_display, D display){
-    // get CFG
-    Cfg cfg = get_cfg_func(func);
-    std::vector<Block>& blocks = cfg.blocks;
+    for(int b = 0; b < cfg.size(); b++){
+        if(!visited[b]) order.push_back(b);
+    }
+    return order;
+}
 
+// sweep the blocks in [order], visiting those [queued], until none are. a block is queued at most
+// once; one whose inputs change while queued is still visited once
+template<typename T, typename M, typename R>
+static void df_sweep(const Cfg& cfg, bool is_forward, const std::vector<int>& order, const T& init, M merge, R transfer,
+                     std::vector<T>& in, std::vector<T>& out, std::vector<bool>& queued, std::vector<bool>& transferred, DFStats* stats){
     // set direction
-    auto preds = cfg.preds;
-    auto succs = cfg.succs;
-    if(!is_forward){
-        succs = cfg.preds;
-        preds = cfg.succs;
+    const Adjacency& preds = cfg.predecessors(is_forward);
+    const Adjacency& succs = cfg.successors(is_forward);
+
+    int num_queued = std::count(queued.begin(), queued.end(), true);
+    T merged = init;
+    while(num_queued > 0){
+        for(int b: order){
+            if(!queued[b]) continue;
+            queued[b] = false;
+            num_queued--;
+            if(stats) stats->visits++;
+
+            // merge from predecessors, starting over from init
+            merged = init;
+            for(int p: preds.at(b)){
+                merge(merged, out[p]);
+            }
+
+            // out[b] is already the transfer of unchanged facts
+            if(transferred[b] && merged == in[b]) continue;
+            std::swap(in[b], merged);
+
+            // transfer through block
+            bool changed = transfer(out[b], in[b], b);
+            transferred[b] = true;
+            if(stats) stats->transfers++;
+
+            // queue successors if changed
+            if(changed){
+                for(int s: succs.at(b)){
+                    if(!queued[s]){
+                        queued[s] = true;
+                        num_queued++;
+                    }
+                }
+            }
+        }
     }
+}
+
+template<typename T, typename M, typename R>
+std::pair<std::vector<T>, std::vector<T>> df_worklist(const Cfg& cfg, bool is_forward, T init, M merge, R transfer, DFStats* stats){
+    // initialize in[*] and out[*]
+    std::vector<T> in(cfg.size(), init);
+    std::vector<T> out(cfg.size(), init);
+
+    std::vector<int> order = df_order(cfg, is_forward);
+    std::vector<bool> queued(cfg.size(), true);
+    std::vector<bool> transferred(cfg.size(), false);
+    df_sweep(cfg, is_forward, order, init, merge, transfer, in, out, queued, transferred, stats);
+
+    return {std::move(in), std::move(out)};
+}
 
-    // initialize in[entry] and out[*]
-    std::unordered_map<int,T> in;
-    std::unordered_map<int,T> out;
-    in[cfg.entryIdx] = init;
-    for(int i = 0; i < blocks.size(); i++){
-        out[i] = init;
+// re-solve [in] and [out], a fixpoint from before the transfer of the blocks in [dirty] changed.
+// facts can shrink as well as grow, and iterating down from the old fixpoint could keep facts that
+// only hold up themselves around a loop, so every block the dirty ones reach starts over from
+// [init]. no other block depends on the change, and each keeps its facts. returns the blocks whose
+// merged facts changed
+template<typename T, typename M, typename R>
+std::vector<int> df_reworklist(const Cfg& cfg, bool is_forward, T init, M merge, R transfer, std::vector<T>& in, std::vector<T>& out,
+                               std::span<const int> dirty, DFStats* stats){
+    const Adjacency& succs = cfg.successors(is_forward);
+
+    // blocks reached from the dirty ones in reverse postorder, by an iterative dfs
+    std::vector<int> order;
+    std::vector<bool> queued(cfg.size());
+    std::vector<std::pair<int,int>> stack; // block and index of the next successor to visit
+    for(int root: dirty){
+        if(queued[root]) continue;
+        queued[root] = true;
+        stack.push_back({root, 0});
+        while(!stack.empty()){
+            auto& [b, next] = stack.back();
+            if(next < succs.at(b).size()){
+                int s = succs.at(b)[next++];
+                if(!queued[s]){
+                    queued[s] = true;
+                    stack.push_back({s, 0});
+                }
+                continue;
+            }
+            order.push_back(b);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+
+    // start the region over, keeping its old merged facts to compare
+    std::vector<T> old_in;
+    old_in.reserve(order.size());
+    std::vector<bool> transferred(cfg.size(), true);
+    for(int b: order){
+        old_in.push_back(std::move(in[b]));
+        in[b] = init;
+        out[b] = init;
+        transferred[b] = false;
     }
+    df_sweep(cfg, is_forward, order, init, merge, transfer, in, out, queued, transferred, stats);
 
-    // queue all blocks in worklist
-    std::queue<int> worklist;
-    for(int i = 0; i < blocks.size(); i++){
-        worklist.push(i);
+    std::vector<int> changed;
+    for(int k = 0; k < order.size(); k++){
+        if(!(in[order[k]] == old_in[k])) changed.push_back(order[k]);
     }
+    std::sort(changed.begin(), changed.end());
+    return changed;
+}
 
-    while(!worklist.empty()){
-        int b = worklist.front(); worklist.pop();
+BitFacts df_gen_kill(const Cfg& cfg, bool is_forward, const std::vector<BitVector>& gen, const std::vector<BitVector>& kill, DFStats* stats){
+    int num_bits = cfg.size() > 0 ? gen[0].size() : 0;
 
-        // merge from predecessors
-        for(int p: preds[b]){
-            merge(in[b], out[p]);
-        }
+    // union the facts of predecessors
+    auto merge = [](BitVector& in_b, const BitVector& pred){
+        in_b.merge(pred);
+    };
 
-        // transfer through block
-        bool changed = transfer(blocks[b], out[b], in[b], b);
+    // out[b] = gen[b] | (in[b] & ~kill[b]), in place
+    auto transfer = [&](BitVector& out_b, const BitVector& in_b, int b){
+        return out_b.transfer(in_b, gen[b], kill[b]);
+    };
 
-        // queue successors if changed
-        if(changed){
-            for(int s: succs[b]){
-                worklist.push(s);
-            }
-        }
+    return df_worklist(cfg, is_forward, BitVector(num_bits), merge, transfer, stats);
+}
+
+// summary of the function [instr] calls, null if it is not a call or the callee has none
+static const FuncSummary* find_callee(const IrFunc& f, const Instr& instr, const FuncSummaries* summaries){
+    if(!summaries || instr.op != Opcode::Call) return nullptr;
+    auto funcs = instr_funcs(f, instr);
+    if(funcs.empty()) return nullptr;
+    auto it = summaries->find(f.funcs.name(funcs[0]));
+    return it == summaries->end() ? nullptr : &it->second;
+}
+
+// call [fn] on each var [instr] reads, skipping args of a call to a param the callee never reads
+template<typename F>
+static void for_each_use(const IrFunc& f, const Instr& instr, const FuncSummaries* summaries, F fn){
+    auto args = instr_args(f, instr);
+    const FuncSummary* callee = find_callee(f, instr, summaries);
+    for(int i = 0; i < args.size(); i++){
+        if(callee && i < callee->used_args.size() && !callee->used_args[i]) continue;
+        fn(args[i]);
     }
-    
-    // display analysis
-    if (is_display) {
-        display(blocks, in, out);
+}
+
+// live vars before [instr] from the live vars after it
+static void live_step(const IrFunc& f, const FuncSummaries* summaries, BitVector& facts, const Instr& instr){
+    if(instr.keys & KEY_DEST){
+        facts.reset(instr.dest);
+    }
+    for_each_use(f, instr, summaries, [&](SymId arg){ facts.set(arg); });
+}
+
+// map facts over var ids back to names
+static std::unordered_map<int, std::set<std::string>> to_name_sets(const std::vector<BitVector>& facts, const IrFunc& f){
+    std::unordered_map<int, std::set<std::string>> named;
+    for(int b = 0; b < facts.size(); b++){
+        auto& names = named[b];
+        facts[b].for_each([&](SymId v){ names.insert(names.end(), f.vars.name(v)); });
     }
-    return {in, out};
+    return named;
+}
+
+static void print_var_set(const std::set<std::string>& vars){
+    if (vars.empty()) {
+        std::cout << "∅";
+    } else {
+        for (auto iter = vars.begin(); iter != vars.end(); iter++) {
+            if (iter != vars.begin()) std::cout << ", ";
+            std::cout << *iter;
+        }
+    }
+    std::cout << std::endl;
 }
 
 // key not present = unknown, std::nullopt = non-constant
@@ -76,109 +227,159 @@ static void print_bril_env(const bril_env& env, const std::string name) {
     std::cout << "}" << std::endl;
 }
 
-DFConstProp df_const_propagation(const json& func, bool is_display) {
-    bril_env init;
+// value of a const instruction as the analysis sees it, by declared type
+static std::optional<bril_value> const_value(const IrFunc& f, const Instr& inst){
+    if (!(inst.keys & KEY_TYPE)) return std::nullopt;
+    const std::string& type = f.types.name(inst.type);
+    auto number = [&]() -> double {
+        if (inst.value_kind == ValueKind::Int) return inst.value.i;
+        if (inst.value_kind == ValueKind::Uint) return inst.value.u;
+        return inst.value.f;
+    };
+    if (type == "int") {
+        if (inst.value_kind == ValueKind::Int) return (int) inst.value.i;
+        if (inst.value_kind == ValueKind::Uint) return (int) inst.value.u;
+        return (int) inst.value.f;
+    }
+    if (type == "float") return (float) number();
+    if (type == "bool") return inst.value.b;
+    if (type == "char") return f.strings.name(inst.value.c)[0];
+    return std::nullopt;
+}
+
+// evaluate [op] on constant [values], nullopt if the op is not folded
+static std::optional<bril_value> fold(Opcode op, const std::vector<bril_value>& values){
+    switch (op) {
+        case Opcode::Add: return std::get<int>(values[0]) + std::get<int>(values[1]);
+        case Opcode::Mul: return std::get<int>(values[0]) * std::get<int>(values[1]);
+        case Opcode::Sub: return std::get<int>(values[0]) - std::get<int>(values[1]);
+        case Opcode::Div: return std::get<int>(values[0]) / std::get<int>(values[1]);
+        case Opcode::Eq: return std::get<int>(values[0]) == std::get<int>(values[1]);
+        case Opcode::Lt: return std::get<int>(values[0]) < std::get<int>(values[1]);
+        case Opcode::Gt: return std::get<int>(values[0]) > std::get<int>(values[1]);
+        case Opcode::Le: return std::get<int>(values[0]) <= std::get<int>(values[1]);
+        case Opcode::Ge: return std::get<int>(values[0]) >= std::get<int>(values[1]);
+
+        case Opcode::Fadd: return std::get<float>(values[0]) + std::get<float>(values[1]);
+        case Opcode::Fmul: return std::get<float>(values[0]) * std::get<float>(values[1]);
+        case Opcode::Fsub: return std::get<float>(values[0]) - std::get<float>(values[1]);
+        case Opcode::Fdiv: return std::get<float>(values[0]) / std::get<float>(values[1]);
+        case Opcode::Feq: return std::get<float>(values[0]) == std::get<float>(values[1]);
+        case Opcode::Flt: return std::get<float>(values[0]) < std::get<float>(values[1]);
+        case Opcode::Fgt: return std::get<float>(values[0]) > std::get<float>(values[1]);
+        case Opcode::Fle: return std::get<float>(values[0]) <= std::get<float>(values[1]);
+        case Opcode::Fge: return std::get<float>(values[0]) >= std::get<float>(values[1]);
+
+        case Opcode::Not: return !std::get<bool>(values[0]);
+        case Opcode::And: return std::get<bool>(values[0]) && std::get<bool>(values[1]);
+        case Opcode::Or: return std::get<bool>(values[0]) || std::get<bool>(values[1]);
+
+        case Opcode::Ceq: return std::get<char>(values[0]) == std::get<char>(values[1]);
+        case Opcode::Clt: return std::get<char>(values[0]) < std::get<char>(values[1]);
+        case Opcode::Cgt: return std::get<char>(values[0]) > std::get<char>(values[1]);
+        case Opcode::Cle: return std::get<char>(values[0]) <= std::get<char>(values[1]);
+        case Opcode::Cge: return std::get<char>(values[0]) >= std::get<char>(values[1]);
+        case Opcode::Char2int: return (int) std::get<char>(values[0]);
+        case Opcode::Int2char: return (char) std::get<int>(values[0]);
+
+        case Opcode::Id: return values[0];
+        default: return std::nullopt;
+    }
+}
+
+DFConstProp df_const_propagation(const json& func, bool is_display, DFStats* stats, const FuncSummaries* summaries) {
+    Cfg cfg = get_cfg_view(func);
+    CfgIr cfg_ir = get_cfg_ir(func);
+    const IrFunc& f = cfg_ir.ir;
 
-    auto merge = [](bril_env& in_b, const bril_env& out_pred) {
-        for (const auto& [var, val] : out_pred) {
-            auto it = in_b.find(var);
-            if (it == in_b.end()) {     // undefined -> add
+    VarEnv init(f.vars.size());
+
+    auto merge = [](VarEnv& in_b, const VarEnv& out_pred) {
+        for (SymId var = 0; var < out_pred.size(); var++) {
+            const auto& val = out_pred[var];
+            if (!val) continue;
+            if (!in_b[var]) {     // undefined -> add
                 in_b[var] = val;
             } else if (
-                it->second == std::nullopt      // non-const
-                || it->second.value() != val    // or conflicting values -> invalidate
+                *in_b[var] == std::nullopt      // non-const
+                || in_b[var]->value() != *val   // or conflicting values -> invalidate
             ) {
-                in_b[var] = std::nullopt;
+                in_b[var] = std::optional<bril_value>();
             }
         }
     };
 
-    auto transfer = [](const Block& block, bril_env& out_b, const bril_env& in_b, int b) {
-        bril_env old_out = out_b;
+    auto transfer = [&](VarEnv& out_b, const VarEnv& in_b, int b) {
+        VarEnv old_out = out_b;
         out_b = in_b;
 
-        for (const auto& inst : block) {
+        for (const auto& inst : cfg_ir.block(b)) {
             // consts
-            if (inst.contains("value")) {
-                std::string type = inst["type"].template get<std::string>();
-                if (type == "int") {
-                    out_b[inst["dest"].template get<std::string>()] = inst["value"].template get<int>();
-                }
-                else if (type == "float") {
-                    out_b[inst["dest"].template get<std::string>()] = inst["value"].template get<float>();
-                }
-                else if (type == "bool") {
-                    out_b[inst["dest"].template get<std::string>()] = inst["value"].template get<bool>();
+            if (inst.value_kind != ValueKind::None) {
+                if (auto val = const_value(f, inst)) {
+                    out_b[inst.dest] = val;
                 }
-                else if (type == "char") {
-                    out_b[inst["dest"].template get<std::string>()] = *(inst["value"].template get<std::string>().c_str());
+                continue;
+            }
+
+            // calls give what the callee always returns, if it is known
+            if (inst.op == Opcode::Call) {
+                if (inst.keys & KEY_DEST) {
+                    const FuncSummary* callee = find_callee(f, inst, summaries);
+                    out_b[inst.dest] = callee ? callee->ret_value : std::optional<bril_value>();
                 }
                 continue;
             }
 
-            if (!inst.contains("op") || !inst.contains("dest") || !inst.contains("args")) continue;
+            if (inst.op == Opcode::Label || !(inst.keys & KEY_DEST) || !(inst.keys & KEY_ARGS)) continue;
 
-            std::string op = inst["op"].template get<std::string>();
-            std::string dest = inst["dest"].template get<std::string>();
-            auto args = inst["args"];
             std::vector<bril_value> values;
-            for (auto arg : args) {
-                std::string var = arg.template get<std::string>();
-                if (out_b.find(var) == out_b.end() || out_b.find(var)->second == std::nullopt) {
-                    out_b[dest] = std::nullopt; // dest depends on a non-const; need to invalidate
-                    goto next_inst;
+            bool is_const = true;
+            for (SymId var : instr_args(f, inst)) {
+                if (!out_b[var] || *out_b[var] == std::nullopt) {
+                    is_const = false;
+                    break;
                 }
-                values.push_back((out_b.find(var)->second).value());
+                values.push_back(out_b[var]->value());
+            }
+            if (!is_const) {
+                out_b[inst.dest] = std::optional<bril_value>(); // dest depends on a non-const; need to invalidate
+                continue;
             }
 
-            if (op == "add") out_b[dest] = std::get<int>(values[0]) + std::get<int>(values[1]);
-            else if (op == "mul") out_b[dest] = std::get<int>(values[0]) * std::get<int>(values[1]);
-            else if (op == "sub") out_b[dest] = std::get<int>(values[0]) - std::get<int>(values[1]);
-            else if (op == "div") out_b[dest] = std::get<int>(values[0]) / std::get<int>(values[1]);
-            else if (op == "eq") out_b[dest] = std::get<int>(values[0]) == std::get<int>(values[1]);
-            else if (op == "lt") out_b[dest] = std::get<int>(values[0]) < std::get<int>(values[1]);
-            else if (op == "gt") out_b[dest] = std::get<int>(values[0]) > std::get<int>(values[1]);
-            else if (op == "le") out_b[dest] = std::get<int>(values[0]) <= std::get<int>(values[1]);
-            else if (op == "ge") out_b[dest] = std::get<int>(values[0]) >= std::get<int>(values[1]);
-
-            else if (op == "fadd") out_b[dest] = std::get<float>(values[0]) + std::get<float>(values[1]);
-            else if (op == "fmul") out_b[dest] = std::get<float>(values[0]) * std::get<float>(values[1]);
-            else if (op == "fsub") out_b[dest] = std::get<float>(values[0]) - std::get<float>(values[1]);
-            else if (op == "fdiv") out_b[dest] = std::get<float>(values[0]) / std::get<float>(values[1]);
-            else if (op == "feq") out_b[dest] = std::get<float>(values[0]) == std::get<float>(values[1]);
-            else if (op == "flt") out_b[dest] = std::get<float>(values[0]) < std::get<float>(values[1]);
-            else if (op == "fgt") out_b[dest] = std::get<float>(values[0]) > std::get<float>(values[1]);
-            else if (op == "fle") out_b[dest] = std::get<float>(values[0]) <= std::get<float>(values[1]);
-            else if (op == "fge") out_b[dest] = std::get<float>(values[0]) >= std::get<float>(values[1]);
-
-            else if (op == "not") out_b[dest] = !std::get<bool>(values[0]);
-            else if (op == "and") out_b[dest] = std::get<bool>(values[0]) && std::get<bool>(values[1]);
-            else if (op == "or") out_b[dest] = std::get<bool>(values[0]) || std::get<bool>(values[1]);
-
-            else if (op == "ceq") out_b[dest] = std::get<char>(values[0]) == std::get<char>(values[1]);
-            else if (op == "clt") out_b[dest] = std::get<char>(values[0]) < std::get<char>(values[1]);
-            else if (op == "cgt") out_b[dest] = std::get<char>(values[0]) > std::get<char>(values[1]);
-            else if (op == "cle") out_b[dest] = std::get<char>(values[0]) <= std::get<char>(values[1]);
-            else if (op == "cge") out_b[dest] = std::get<char>(values[0]) >= std::get<char>(values[1]);
-            else if (op == "char2int") out_b[dest] = (int) std::get<char>(values[0]);
-            else if (op == "int2char") out_b[dest] = (char) std::get<int>(values[0]);
-            
-            else if (op == "id") out_b[dest] = values[0];
-            else continue;
-
-            next_inst:;
+            if (auto val = fold(inst.op, values)) {
+                out_b[inst.dest] = val;
+            }
         }
 
         return old_out != out_b;
     };
 
-    auto display = [](std::vector<Block>& blocks, std::unordered_map<int, bril_env>& in, std::unordered_map<int, bril_env> out) {
+    auto [in_ids, out_ids] = df_worklist(cfg, true, init, merge, transfer, stats);
+
+    // map back to names
+    auto to_env = [&](const std::vector<VarEnv>& facts) {
+        std::unordered_map<int, bril_env> named;
+        for (int b = 0; b < facts.size(); b++) {
+            const auto& env = facts[b];
+            auto& cur = named[b];
+            for (SymId var = 0; var < env.size(); var++) {
+                if (env[var]) cur[f.vars.name(var)] = *env[var];
+            }
+        }
+        return named;
+    };
+    auto in = to_env(in_ids);
+    auto out = to_env(out_ids);
+
+    if (is_display) {
         int unlabeled_block_count = 0;
-        for (int i = 0; i < blocks.size(); ++i) {
-            if (blocks[i].size() == 0) continue;
+        for (int i = 0; i < cfg.size(); ++i) {
+            auto block = cfg.block(i);
+            if (block.size() == 0) continue;
             std::string label = "b" + std::to_string(unlabeled_block_count);
-            if (blocks[i][0].contains("label")) {
-                label = blocks[i][0]["label"].template get<std::string>();
+            if (block[0].contains("label")) {
+                label = block[0]["label"].template get<std::string>();
             } else {
                 ++unlabeled_block_count;
             }
@@ -186,104 +387,204 @@ DFConstProp df_const_propagation(const json& func, bool is_display) {
             print_bril_env(in[i], "in");
             print_bril_env(out[i], "out");
         }
-    };
+    }
 
-    return df_worklist(func, true, init, merge, transfer, is_display, display);
+    return {std::move(in), std::move(out)};
 }
 
 // defined vars df analysis
-DFDefinedVars df_defined_vars(const json& func, bool is_display){
-    // create init
-    std::set<std::string> init;
-    // if(func.contains("args")){
-    //     for(auto arg: func["args"]){
-    //         init.insert(arg["name"]);
-    //     }
-    // }
-
-    // create merge
-    auto merge = [](std::set<std::string>& in_b, const std::set<std::string>& pred){
-        in_b.insert(pred.begin(), pred.end());
-    };
+DFDefinedVars df_defined_vars(const json& func, bool is_display, DFStats* stats){
+    Cfg cfg = get_cfg_view(func);
+    CfgIr cfg_ir = get_cfg_ir(func);
+    const IrFunc& f = cfg_ir.ir;
+
+    // gen every var assigned in the block, kill nothing
+    std::vector<BitVector> gen(cfg.size(), BitVector(f.vars.size()));
+    std::vector<BitVector> kill(cfg.size(), BitVector(f.vars.size()));
+    for(int b = 0; b < cfg.size(); b++){
+        for(const auto& instr: cfg_ir.block(b)){
+            if(instr.keys & KEY_DEST){
+                gen[b].set(instr.dest);
+            }
+        }
+    }
 
-    // create transfer
-    auto transfer = [](const Block& block, std::set<std::string>& out_b, const std::set<std::string>& in_b, int b){
-        int prev_size = out_b.size();
-        auto defs = get_defs(block);
-        defs.insert(in_b.begin(), in_b.end());
-        out_b = std::move(defs);
-        return prev_size != out_b.size();
-    };
+    auto [in_ids, out_ids] = df_gen_kill(cfg, true, gen, kill, stats);
+    auto in = to_name_sets(in_ids, f);
+    auto out = to_name_sets(out_ids, f);
 
-    // create display
-    auto display = [](std::vector<Block>& blocks, std::unordered_map<int,std::set<std::string>>& in, std::unordered_map<int,std::set<std::string>>& out){
+    // display
+    if(is_display){
         int empty_block_counter = 1;
-        for(int i = 0; i < blocks.size(); i++){
+        for(int i = 0; i < cfg.size(); i++){
+            auto block = cfg.block(i);
             auto label = "b" + std::to_string(empty_block_counter);
-            if (blocks[i][0].contains("label")) {
-                label = blocks[i][0]["label"];
+            if (!block.empty() && block[0].contains("label")) {
+                label = block[0]["label"];
             } else {
                 empty_block_counter++;
             }
             std::cout << label << ":" << std::endl;
             std::cout << "  in:  ";
-            if (in[i].empty()) {
-                std::cout << "∅";
-            } else {
-                for (auto iter = in[i].begin(); iter != in[i].end(); iter++) {
-                    if (iter != in[i].begin()) std::cout << ", ";
-                    std::cout << *iter;
-                }
-            }
-            std::cout << std::endl;
+            print_var_set(in[i]);
             std::cout << "  out: ";
-            if (out[i].empty()) {
-                std::cout << "∅";
-            } else {
-                for (auto iter = out[i].begin(); iter != out[i].end(); iter++) {
-                    if (iter != out[i].begin()) std::cout << ", ";
-                    std::cout << *iter;
-                }
-            }
-            std::cout << std::endl;
+            print_var_set(out[i]);
         }
-    };
+    }
 
-    return df_worklist(func, true, init, merge, transfer, is_display, display);
+    return {std::move(in), std::move(out)};
 }
 
-// reaching defs df analysis
-DFReachingDefs df_reaching_defs(const json& func, bool is_display){
-    // create init
-    DefStore init;
-
-    // create merge
-    auto merge = [](DefStore& in_b, const DefStore& pred){
-        for(const auto& cur: pred){
-            auto& prev_defs = cur.second;
-            in_b[cur.first].insert(prev_defs.begin(), prev_defs.end());
+DefUse::DefUse(const Cfg& cfg, const CfgIr& cfg_ir, DFStats* stats){
+    const IrFunc& f = cfg_ir.ir;
+    int num_instrs = f.instrs.size();
+
+    // number the defs: params on entry, then every assignment in body order
+    instr_defs.assign(num_instrs, -1);
+    std::vector<std::vector<int>> block_defs(cfg.size());
+    auto add_def = [&](int i, int b, SymId var){
+        if(i != -1) instr_defs[i] = def_instrs.size();
+        block_defs[b].push_back(def_instrs.size());
+        def_instrs.push_back(i);
+        def_blocks.push_back(b);
+        def_vars.push_back(var);
+    };
+    if(cfg.size() > 0){
+        for(const auto& param: f.params){
+            add_def(-1, cfg.entryIdx, param.var);
+        }
+    }
+    for(int b = 0; b < cfg.size(); b++){
+        if(b >= cfg_ir.ranges.size()) continue;
+        for(int i = cfg_ir.ranges[b].begin; i < cfg_ir.ranges[b].end; i++){
+            if(f.instrs[i].keys & KEY_DEST){
+                add_def(i, b, f.instrs[i].dest);
+            }
+        }
+    }
+
+    // defs of each var, bucketed by var
+    var_def_start.assign(f.vars.size() + 1, 0);
+    for(SymId var: def_vars){
+        var_def_start[var + 1]++;
+    }
+    for(int v = 0; v < f.vars.size(); v++){
+        var_def_start[v + 1] += var_def_start[v];
+    }
+    var_defs.resize(num_defs());
+    std::vector<int> next(var_def_start.begin(), var_def_start.end() - 1);
+    for(int d = 0; d < num_defs(); d++){
+        var_defs[next[def_vars[d]]++] = d;
+    }
+
+    // a block gens the last def of each var it assigns and kills every other def of those vars
+    std::vector<BitVector> gen(cfg.size(), BitVector(num_defs()));
+    std::vector<BitVector> kill(cfg.size(), BitVector(num_defs()));
+    for(int b = 0; b < cfg.size(); b++){
+        // walk backwards so each var is handled once, at its last def; earlier ones are killed by then
+        for(auto d = block_defs[b].rbegin(); d != block_defs[b].rend(); d++){
+            if(kill[b].test(*d)) continue;
+            for(int other: defs_of(def_vars[*d])){
+                kill[b].set(other);
+            }
+            gen[b].set(*d);
+        }
+    }
+    facts = df_gen_kill(cfg, true, gen, kill, stats);
+
+    // replay each block from the defs reaching into it to find the defs reaching each use
+    arg_base.assign(num_instrs + 1, 0);
+    for(int i = 0; i < num_instrs; i++){
+        arg_base[i + 1] = arg_base[i] + instr_args(f, f.instrs[i]).size();
+    }
+    reach_start.reserve(arg_base[num_instrs] + 1);
+    reach_start.push_back(0);
+
+    // instructions in no block (dead code after a terminator) reach nothing
+    int next_instr = 0;
+    auto skip_to = [&](int i){
+        for(; next_instr < i; next_instr++){
+            reach_start.insert(reach_start.end(), arg_base[next_instr + 1] - arg_base[next_instr], reach_defs.size());
         }
     };
+    for(int b = 0; b < cfg.size(); b++){
+        BitVector cur = facts.first[b];
+        auto define = [&](int d){
+            for(int other: defs_of(def_vars[d])){
+                cur.reset(other);
+            }
+            cur.set(d);
+        };
+        for(int d: block_defs[b]){
+            if(def_instrs[d] == -1) define(d);
+        }
+        if(b >= cfg_ir.ranges.size()) continue;
+        skip_to(cfg_ir.ranges[b].begin);
+        next_instr = cfg_ir.ranges[b].end;
+        for(int i = cfg_ir.ranges[b].begin; i < cfg_ir.ranges[b].end; i++){
+            for(SymId arg: instr_args(f, f.instrs[i])){
+                for(int d: defs_of(arg)){
+                    if(cur.test(d)) reach_defs.push_back(d);
+                }
+                reach_start.push_back(reach_defs.size());
+            }
+            if(instr_defs[i] != -1) define(instr_defs[i]);
+        }
+    }
+    skip_to(num_instrs);
 
-    // create transfer
-    auto transfer = [](const Block& block, DefStore& out_b, const DefStore& in_b, int b){
-        auto prev_out_b = out_b;
-        out_b = in_b;
-        std::string block_id = "b" + std::to_string(b) + ".";
-        for(int i = 0; i < block.size(); i++){
-            const auto& instr = block[i];
-            if(instr.contains("dest")){
-                out_b[instr["dest"]] = {block_id + std::to_string(i)};
+    // invert into the uses of each def
+    use_start.assign(num_defs() + 1, 0);
+    for(int d: reach_defs){
+        use_start[d + 1]++;
+    }
+    for(int d = 0; d < num_defs(); d++){
+        use_start[d + 1] += use_start[d];
+    }
+    def_uses.resize(reach_defs.size());
+    next.assign(use_start.begin(), use_start.end() - 1);
+    for(int i = 0; i < num_instrs; i++){
+        for(int arg = 0; arg < arg_base[i + 1] - arg_base[i]; arg++){
+            for(int d: reaching(i, arg)){
+                def_uses[next[d]++] = {i, arg};
             }
         }
-        return prev_out_b != out_b;
+    }
+}
+
+int DefUse::unique_def(int i, int arg) const {
+    auto defs = reaching(i, arg);
+    return defs.size() == 1 ? defs[0] : -1;
+}
+
+// reaching defs df analysis
+DFReachingDefs df_reaching_defs(const json& func, bool is_display, DFStats* stats){
+    Cfg cfg = get_cfg_view(func);
+    CfgIr cfg_ir = get_cfg_ir(func);
+    const IrFunc& f = cfg_ir.ir;
+    DefUse du(cfg, cfg_ir, stats);
+
+    // map back to names, defs are named b<block>.<instr>; params are not shown
+    auto to_def_store = [&](const std::vector<BitVector>& facts){
+        std::unordered_map<int, DefStore> named;
+        for(int b = 0; b < facts.size(); b++){
+            auto& cur = named[b];
+            facts[b].for_each([&](int d){
+                if(du.def_instr(d) == -1) return;
+                int def_b = du.def_block(d);
+                cur[f.vars.name(du.def_var(d))].insert("b" + std::to_string(def_b) + "." + std::to_string(du.def_instr(d) - cfg_ir.ranges[def_b].begin));
+            });
+        }
+        return named;
     };
+    auto in = to_def_store(du.block_facts().first);
+    auto out = to_def_store(du.block_facts().second);
 
-    // create display
-    auto display = [](const std::vector<Block>& blocks, std::unordered_map<int,DefStore>& in, std::unordered_map<int,DefStore>& out){
-        for(int i = 0; i < blocks.size(); i++){
+    // display
+    if(is_display){
+        for(int i = 0; i < cfg.size(); i++){
             std::cout << "b" << i << std::endl;
-            
+
             // display in
             std::cout << "  in:  " << std::endl;
             for(const auto& cur: in[i]){
@@ -294,7 +595,7 @@ DFReachingDefs df_reaching_defs(const json& func, bool is_display){
                 std::cout << std::endl;
             }
             std::cout << std::endl;
-            
+
             // display out
             std::cout << "  out:  " << std::endl;
             for(const auto& cur: out[i]){
@@ -306,81 +607,148 @@ DFReachingDefs df_reaching_defs(const json& func, bool is_display){
             }
             std::cout << std::endl;
         }
-    };
+    }
 
-    return df_worklist(func, true, init, merge, transfer, is_display, display);
+    return {std::move(in), std::move(out)};
 }
 
 // live vars df analysis
-DFLiveVars df_live_vars(const json& func, bool is_display){
-    // create init
-    std::set<std::string> init;
+BitFacts df_live_bits(const Cfg& cfg, const CfgIr& cfg_ir, DFStats* stats, const FuncSummaries* summaries){
+    const IrFunc& f = cfg_ir.ir;
+
+    // walking the block backwards, gen the vars used before any def in the block and kill the defined ones
+    std::vector<BitVector> gen(cfg.size(), BitVector(f.vars.size()));
+    std::vector<BitVector> kill(cfg.size(), BitVector(f.vars.size()));
+    for(int b = 0; b < cfg.size(); b++){
+        auto block = cfg_ir.block(b);
+        for(int i = block.size()-1; i >= 0; i--){
+            const auto& instr = block[i];
+            if(instr.keys & KEY_DEST){
+                gen[b].reset(instr.dest);
+                kill[b].set(instr.dest);
+            }
+            for_each_use(f, instr, summaries, [&](SymId arg){ gen[b].set(arg); });
+        }
+    }
 
-    // create merge
-    auto merge = [](std::set<std::string>& in_b, const std::set<std::string>& pred){
-        in_b.insert(pred.begin(), pred.end());
-    };
+    return df_gen_kill(cfg, false, gen, kill, stats);
+}
 
-    // create transfer
-    auto transfer = [](const Block& block, std::set<std::string>& out_b, const std::set<std::string>& in_b, int b){
-        std::set<std::string> out_new(in_b);
+std::vector<int> df_live_bits_update(const Cfg& cfg, const CfgIr& cfg_ir, BitFacts& live, std::span<const int> dirty, DFStats* stats, const FuncSummaries* summaries){
+    const IrFunc& f = cfg_ir.ir;
+    auto merge = [](BitVector& out_b, const BitVector& succ){
+        out_b.merge(succ);
+    };
 
+    // replay the block backwards; only the re-solved blocks are transferred
+    BitVector facts(f.vars.size());
+    auto transfer = [&](BitVector& in_b, const BitVector& out_b, int b){
+        facts = out_b;
+        auto block = cfg_ir.block(b);
         for(int i = block.size()-1; i >= 0; i--){
-            const json& instr = block[i];
-            // removed killed
-            std::string dest = "";
-            if(instr.contains("dest")){
-                out_new.erase(instr["dest"]);
-            }
-
-            // add uses
-            if(instr.contains("args")){
-                for(auto arg: instr["args"]){
-                    if(!out_new.contains(arg)){
-                        out_new.insert(arg);
-                    }
-                }
-            }
+            live_step(f, summaries, facts, block[i]);
         }
-
-        bool changed = out_new != out_b;
-        out_b = std::move(out_new);
+        bool changed = !(facts == in_b);
+        std::swap(in_b, facts);
         return changed;
     };
+    return df_reworklist(cfg, false, BitVector(f.vars.size()), merge, transfer, live.first, live.second, dirty, stats);
+}
+
+DFLiveVars df_live_vars(const json& func, bool is_display, DFStats* stats, const FuncSummaries* summaries){
+    return df_live_vars(get_cfg_view(func), get_cfg_ir(func), is_display, stats, summaries);
+}
+
+DFLiveVars df_live_vars(const Cfg& cfg, const CfgIr& cfg_ir, bool is_display, DFStats* stats, const FuncSummaries* summaries){
+    const IrFunc& f = cfg_ir.ir;
+    auto [in_ids, out_ids] = df_live_bits(cfg, cfg_ir, stats, summaries);
+    auto in = to_name_sets(in_ids, f);
+    auto out = to_name_sets(out_ids, f);
 
-    // create display
-    auto display = [](std::vector<Block>& blocks, std::unordered_map<int,std::set<std::string>>& in, std::unordered_map<int,std::set<std::string>>& out){
+    // display
+    if(is_display){
         int empty_block_counter = 1;
-        for(int i = 0; i < blocks.size(); i++){
+        for(int i = 0; i < cfg.size(); i++){
+            auto block = cfg.block(i);
             auto label = "b" + std::to_string(empty_block_counter);
-            if (blocks[i][0].contains("label")) {
-                label = blocks[i][0]["label"];
+            if (!block.empty() && block[0].contains("label")) {
+                label = block[0]["label"];
             } else {
                 empty_block_counter++;
             }
             std::cout << label << ":" << std::endl;
             std::cout << "  in:  ";
-            if (out[i].empty()) {
-                std::cout << "∅";
-            } else {
-                for (auto iter = out[i].begin(); iter != out[i].end(); iter++) {
-                    if (iter != out[i].begin()) std::cout << ", ";
-                    std::cout << *iter;
-                }
-            }
-            std::cout << std::endl;
+            print_var_set(out[i]);
             std::cout << "  out: ";
-            if (in[i].empty()) {
-                std::cout << "∅";
-            } else {
-                for (auto iter = in[i].begin(); iter != in[i].end(); iter++) {
-                    if (iter != in[i].begin()) std::cout << ", ";
-                    std::cout << *iter;
-                }
-            }
-            std::cout << std::endl;
+            print_var_set(in[i]);
         }
-    };
+    }
+
+    return {std::move(in), std::move(out)};
+}
+
+BitVector InstrFacts::at(int b, int k) const {
+    auto block = cfg_ir->block(b);
+    BitVector facts = block_facts->first[b];
+    if(is_forward){
+        for(int i = 0; i < k; i++){
+            step(facts, block[i]);
+        }
+    } else {
+        for(int i = block.size()-1; i >= k; i--){
+            step(facts, block[i]);
+        }
+    }
+    return facts;
+}
+
+std::vector<BitVector> InstrFacts::snapshots(int b) const {
+    auto block = cfg_ir->block(b);
+    std::vector<BitVector> points(block.size() + 1);
+    BitVector facts = block_facts->first[b];
+    if(is_forward){
+        points[0] = facts;
+        for(int i = 0; i < block.size(); i++){
+            step(facts, block[i]);
+            points[i + 1] = facts;
+        }
+    } else {
+        points[block.size()] = facts;
+        for(int i = block.size()-1; i >= 0; i--){
+            step(facts, block[i]);
+            points[i] = facts;
+        }
+    }
+    return points;
+}
+
+std::vector<std::pair<int,int>> InstrFacts::after_ranges(int b) const {
+    auto block = cfg_ir->block(b);
+    BitVector facts = block_facts->first[b];
+    std::vector<std::pair<int,int>> ranges(facts.size(), {-1, -1});
+    if(is_forward){
+        for(int i = 0; i < block.size(); i++){
+            step(facts, block[i]);
+            facts.for_each([&](int bit){
+                if(ranges[bit].first == -1) ranges[bit].first = i;
+                ranges[bit].second = i;
+            });
+        }
+    } else {
+        for(int i = block.size()-1; i >= 0; i--){
+            facts.for_each([&](int bit){
+                if(ranges[bit].second == -1) ranges[bit].second = i;
+                ranges[bit].first = i;
+            });
+            step(facts, block[i]);
+        }
+    }
+    return ranges;
+}
 
-    return df_worklist(func, false, init, merge, transfer, is_display, display);
+InstrFacts live_instr_facts(const CfgIr& cfg_ir, const BitFacts& live, const FuncSummaries* summaries){
+    const IrFunc& f = cfg_ir.ir;
+    return InstrFacts(cfg_ir, live, false, [&f, summaries](BitVector& facts, const Instr& instr){
+        live_step(f, summaries, facts, instr);
+    });
 }
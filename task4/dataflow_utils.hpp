@@ -4,25 +4,179 @@
 #include <fstream>
 #include <string>
 #include <set>
+#include <map>
 #include <unordered_map>
+#include <optional>
+#include <functional>
 #include <queue>
+#include <algorithm>
+#include <variant>
 #include <nlohmann/json.hpp>
 
 #include "../task2/cfg/cfg_utils.hpp"
+#include "../task2/cfg/analysis_manager.hpp"
+#include "bitvector.hpp"
 
 using bril_value = std::variant<int, float, bool, char>;
-using bril_env = std::unordered_map<std::string, std::optional<bril_value>>;
-using DefStore = std::unordered_map<std::string,std::set<std::string>>;
+using bril_env = std::map<std::string, std::optional<bril_value>>;
+using DefStore = std::map<std::string,std::set<std::string>>;
+
+// facts over variable ids of a CfgIr, as the analyses compute them
+using VarSet = std::vector<bool>;
+using VarEnv = std::vector<std::optional<std::optional<bril_value>>>; // outer nullopt = unknown, inner nullopt = non-constant
+
+// facts over bit positions (var ids, def ids) by block, as the worklist leaves them: first the
+// merged facts, then the transferred ones. for a backward analysis the first are at block exit
+using BitFacts = std::pair<std::vector<BitVector>, std::vector<BitVector>>;
+
+// work done solving one dataflow problem, to compare how fast analyses converge
+struct DFStats {
+    long visits = 0;    // blocks taken off the worklist
+    long transfers = 0; // transfer functions run; a visit whose merged facts did not change skips it
+};
+
+// what a caller needs to know about a function, so that a call to it is not opaque
+struct FuncSummary {
+    std::vector<bool> used_args;         // by param, whether its value on entry may be read
+    std::optional<bril_value> ret_value; // the constant every ret returns, if there is one
+    bool has_side_effects = true;        // stores, prints or frees, itself or through a callee
+};
+
+// summaries by function name; a call to a function without one is treated as opaque
+using FuncSummaries = std::unordered_map<std::string, FuncSummary>;
 
 using DFLiveVars = std::pair<std::unordered_map<int, std::set<std::string>>, std::unordered_map<int, std::set<std::string>>>;
 using DFDefinedVars = std::pair<std::unordered_map<int, std::set<std::string>>, std::unordered_map<int, std::set<std::string>>>;
 using DFConstProp = std::pair<std::unordered_map<int, bril_env>, std::unordered_map<int, bril_env>>;
 using DFReachingDefs = std::pair<std::unordered_map<int, DefStore>, std::unordered_map<int, DefStore>>;
 
-DFLiveVars df_live_vars(const json& func, bool is_display);
+// solve out[b] = gen[b] | (in[b] & ~kill[b]), with in[b] the union of out over the predecessors of
+// b (successors if not [is_forward]); gen and kill are indexed by block and all of one size
+BitFacts df_gen_kill(const Cfg& cfg, bool is_forward, const std::vector<BitVector>& gen, const std::vector<BitVector>& kill, DFStats* stats = nullptr);
+
+// with [summaries], an argument of a call is only a use if the callee may read that param
+DFLiveVars df_live_vars(const json& func, bool is_display, DFStats* stats = nullptr, const FuncSummaries* summaries = nullptr);
+
+// live var ids of a function, live out of each block then live into it
+BitFacts df_live_bits(const Cfg& cfg, const CfgIr& cfg_ir, DFStats* stats = nullptr, const FuncSummaries* summaries = nullptr);
+
+// same, over the cfg of a function and its lowered body
+DFLiveVars df_live_vars(const Cfg& cfg, const CfgIr& cfg_ir, bool is_display, DFStats* stats = nullptr, const FuncSummaries* summaries = nullptr);
+
+// re-solve [live], found by df_live_bits before instructions of the blocks in [dirty] changed in
+// [cfg_ir], without starting over: only those blocks and the ones that reach them are solved again,
+// and the rest keep their facts. the edges must not have changed. returns the blocks whose live-out
+// vars changed, sorted
+std::vector<int> df_live_bits_update(const Cfg& cfg, const CfgIr& cfg_ir, BitFacts& live, std::span<const int> dirty, DFStats* stats = nullptr, const FuncSummaries* summaries = nullptr);
+
+DFDefinedVars df_defined_vars(const json& func, bool is_display, DFStats* stats = nullptr);
+
+DFReachingDefs df_reaching_defs(const json& func, bool is_display, DFStats* stats = nullptr);
+
+// the dest of a call is non-constant, or with [summaries] the constant the callee always returns
+DFConstProp df_const_propagation(const json& func, bool is_display, DFStats* stats = nullptr, const FuncSummaries* summaries = nullptr);
+
+// facts at the instruction boundaries of a gen/kill problem, worked out on demand by replaying one
+// block from its block facts. point k of a block with n instructions is just before instruction k,
+// point n its end. views the CfgIr and the block facts it was made from
+class InstrFacts {
+public:
+    // applies one instruction to the facts, in the direction of the problem
+    using Step = std::function<void(BitVector& facts, const Instr& instr)>;
+
+    InstrFacts(const CfgIr& cfg_ir, const BitFacts& block_facts, bool is_forward, Step step)
+        : cfg_ir(&cfg_ir), block_facts(&block_facts), is_forward(is_forward), step(std::move(step)) {}
+
+    // facts at point [k] of block [b]
+    BitVector at(int b, int k) const;
+
+    BitVector before(int b, int i) const { return at(b, i); }
+    BitVector after(int b, int i) const { return at(b, i + 1); }
+
+    // the facts at every point of block [b], one bitset snapshot each
+    std::vector<BitVector> snapshots(int b) const;
+
+    // for each bit, the first and last instruction of block [b] after which it is set, {-1, -1} if
+    // it never is; one pass over the block and one pair per bit
+    std::vector<std::pair<int,int>> after_ranges(int b) const;
+
+private:
+    const CfgIr* cfg_ir;
+    const BitFacts* block_facts;
+    bool is_forward;
+    Step step;
+};
+
+// live var ids before and after each instruction, from the live vars by block [live], found with
+// the same [summaries]
+InstrFacts live_instr_facts(const CfgIr& cfg_ir, const BitFacts& live, const FuncSummaries* summaries = nullptr);
+
+// argument [arg] of instruction [instr], which indexes the lowered body of a CfgIr
+struct Use {
+    int instr;
+    int arg;
+};
+
+// reaching definitions of a function as a def-use / use-def index. defs are numbered in body order,
+// after one def per param, made on entry by no instruction; each use maps to the defs that reach
+// it and each def to the uses it reaches, so every lookup is a table access
+class DefUse {
+public:
+    DefUse(const Cfg& cfg, const CfgIr& cfg_ir, DFStats* stats = nullptr);
+
+    int num_defs() const { return def_instrs.size(); }
+
+    // instruction making def [d], -1 for a param; its block; the var it assigns
+    int def_instr(int d) const { return def_instrs[d]; }
+    int def_block(int d) const { return def_blocks[d]; }
+    SymId def_var(int d) const { return def_vars[d]; }
+
+    // def made by instruction [i], -1 if it assigns nothing
+    int instr_def(int i) const { return instr_defs[i]; }
+
+    // every def of [var], in body order
+    std::span<const int> defs_of(SymId var) const { return row(var_def_start, var_defs, var); }
+
+    // defs reaching argument [arg] of instruction [i]; empty if the var is never assigned on the way
+    std::span<const int> reaching(int i, int arg) const { return row(reach_start, reach_defs, arg_base[i] + arg); }
+
+    // the only def reaching argument [arg] of instruction [i], -1 if there is not exactly one
+    int unique_def(int i, int arg) const;
+
+    // uses def [d] reaches, in body order
+    std::span<const Use> uses(int d) const { return row(use_start, def_uses, d); }
+
+    // def ids reaching into each block, then out of it
+    const BitFacts& block_facts() const { return facts; }
+
+private:
+    std::vector<int> def_instrs;
+    std::vector<int> def_blocks;
+    std::vector<SymId> def_vars;
+    std::vector<int> instr_defs;
+
+    // rows of flat arrays, row r being [start[r], start[r + 1])
+    std::vector<int> var_def_start, var_defs;
+    std::vector<int> arg_base;   // use number of the first argument of each instruction
+    std::vector<int> reach_start, reach_defs;
+    std::vector<int> use_start;
+    std::vector<Use> def_uses;
+    BitFacts facts;
 
-DFDefinedVars df_defined_vars(const json& func, bool is_display);
+    template<typename T>
+    static std::span<const T> row(const std::vector<int>& start, const std::vector<T>& items, int r){
+        return {items.data() + start[r], (size_t) (start[r + 1] - start[r])};
+    }
+};
 
-DFReachingDefs df_reaching_defs(const json& func, bool is_display);
+// cached def-use index of a function
+struct DefUseAnalysis {
+    using Result = DefUse;
+    static Result run(const json&, AnalysisManager& am) { return DefUse(am.get<CfgAnalysis>(), am.get<CfgIrAnalysis>()); }
+};
 
-DFConstProp df_const_propagation(const json& func, bool is_display);
\ No newline at end of file
+// cached live var ids (outs and ins by block) of a function
+struct LiveVarsAnalysis {
+    using Result = BitFacts;
+    static Result run(const json&, AnalysisManager& am) { return df_live_bits(am.get<CfgAnalysis>(), am.get<CfgIrAnalysis>()); }
+};
\ No newline at end of file
@@ -1,46 +1,44 @@
 #include "dom_utils.hpp"
+#include "../task2/cfg/stream_utils.hpp"
 
 int main(int argc, char* argv[]) {
     // get utility type
     if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <dom|tree|frontier>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <dom|tree|frontier|cdg>" << std::endl;
         return 1;
     }
     std::string utility_type = argv[1];
+    if(utility_type != "dom" && utility_type != "tree" && utility_type != "frontier" && utility_type != "cdg"){
+        std::cout << "ERROR: Unknown df type, got " << utility_type << std::endl;
+        return 1;
+    }
 
-    // open bril json
-    json j;
+    // do analysis on each function as it is read
     try {
-        std::cin >> j;
+        for_each_func(std::cin, [&](json& func){
+            AnalysisManager am(func);
+            const Cfg& cfg = am.get<CfgAnalysis>();
+            const DomTree& tree = am.get<DomTreeAnalysis>();
+            verify_dom_tree(tree, cfg);
+
+            if(utility_type == "dom"){
+                print_dom(am.get<DomAnalysis>(), cfg);
+            } else if(utility_type == "tree"){
+                print_dom(tree.rows(), cfg);
+            } else if(utility_type == "frontier"){
+                print_dom(am.get<DomFrontierAnalysis>(), cfg);
+            } else {
+                // post-dominators are dominators of the reverse cfg
+                verify_dom_tree(am.get<PostDomTreeAnalysis>(), am.get<ReverseCfgAnalysis>());
+                print_dom(am.get<ControlDepAnalysis>(), cfg);
+            }
+        });
     } catch (const json::parse_error& e) {
         std::cerr << "ERROR: Failed to parse JSON from stdin, " << e.what() << std::endl;
         return 1;
-    }
-    
-    // do analysis
-    for(auto& func: j["functions"]){
-        const Dom dom = get_dom(func);
-        const Cfg cfg = get_cfg_func(func);
-        verify_dominators(dom, cfg);
-        const Dom dom_brute_force = find_dominators_brute_force(cfg);
-
-        if (dom != dom_brute_force) {
-            std::cout << "ERROR: Dominator sets don't match up" << std::endl;
-            // throw std::runtime_error("Dominator sets don't match up.");
-        }
-
-        if(utility_type == "dom"){
-            print_dom(dom, cfg);
-        } else if(utility_type == "tree"){
-            auto tree = get_dom_tree(dom, cfg);
-            print_dom(tree, cfg);
-        } else if(utility_type == "frontier"){
-            auto front = get_dom_frontier(dom, cfg);
-            print_dom(front, cfg);
-        } else {
-            std::cout << "ERROR: Unknown df type, got " << utility_type << std::endl;
-            return 1;
-        }
+    } catch (const std::runtime_error& e) {
+        std::cout << "ERROR: " << e.what() << std::endl;
+        return 1;
     }
 
     return 0;
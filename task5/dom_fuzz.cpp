@@ -0,0 +1,194 @@
+#include <mutex>
+#include <random>
+#include <sstream>
+
+#include "dom_utils.hpp"
+#include "../task2/cfg/stream_utils.hpp"
+#include "../task2/cfg/thread_pool.hpp"
+
+// random cfg of 1 to [max_blocks] blocks with block 0 as the entry. most edges go a little way
+// forward, as in code with branches and loops, and the rest go anywhere, so irreducible loops and
+// unreachable blocks turn up too
+static Cfg random_cfg(std::mt19937& rng, int max_blocks){
+    int n = 1 + rng() % max_blocks;
+    std::vector<std::pair<int,int>> edges;
+    for(int b = 0; b < n; b++){
+        int num_succs = rng() % 3;
+        for(int k = 0; k < num_succs; k++){
+            int s = rng() % 4 ? std::min(n-1, b + 1 + (int) (rng() % 3)) : rng() % n;
+            edges.push_back({b, s});
+        }
+    }
+    Cfg cfg;
+    cfg.succs = Adjacency(n, edges);
+    cfg.preds = cfg.succs.transpose();
+    cfg.entryIdx = 0;
+    return cfg;
+}
+
+static std::string describe(const Cfg& cfg){
+    std::ostringstream out;
+    out << cfg.size() << " blocks:";
+    for(int b = 0; b < cfg.size(); b++){
+        for(int s: cfg.succs.at(b)){
+            out << " " << b << "->" << s;
+        }
+    }
+    return out.str();
+}
+
+// dominance frontiers checked against the definition: s is in the frontier of x when x dominates a
+// pred of s but does not strictly dominate s
+static void check_frontier(const Cfg& cfg, const DomTree& tree, const DomFrontier& front){
+    for(int x = 0; x < cfg.size(); x++){
+        if(!tree.reachable(x)) continue;
+        std::vector<int> expected;
+        for(int s = 0; s < cfg.size(); s++){
+            if(!tree.reachable(s) || tree.strictly_dominates(x, s)) continue;
+            for(int p: cfg.preds.at(s)){
+                if(tree.reachable(p) && tree.dominates(x, p)){
+                    expected.push_back(s);
+                    break;
+                }
+            }
+        }
+        auto row = front.at(x);
+        if(!std::equal(row.begin(), row.end(), expected.begin(), expected.end())){
+            throw std::runtime_error("frontier of b" + std::to_string(x) + " is wrong");
+        }
+    }
+}
+
+// random edits applied to [cfg], checking the incremental idoms against a rebuild after each
+static void check_incremental(std::mt19937& rng, Cfg& cfg, int edits){
+    IncrementalDom inc(cfg);
+    for(int e = 0; e < edits; e++){
+        int kind = rng() % 3;
+        int a = rng() % cfg.size();
+        if(kind == 0){
+            int b = rng() % cfg.size();
+            if(cfg.succs.has_edge(a, b)) continue;
+            cfg.succs.insert(a, b);
+            cfg.preds.insert(b, a);
+            inc.insert_edge(a, b);
+        } else if(kind == 1){
+            auto succs = cfg.succs.at(a);
+            if(succs.empty()) continue;
+            int b = succs[rng() % succs.size()];
+            cfg.succs.erase(a, b);
+            cfg.preds.erase(b, a);
+            inc.delete_edge(a, b);
+        } else {
+            // split some of the edges into a
+            std::vector<int> from;
+            for(int p: cfg.preds.at(a)){
+                if(rng() % 2) from.push_back(p);
+            }
+            int nb = cfg.succs.add_node();
+            cfg.preds.add_node();
+            for(int p: from){
+                cfg.succs.erase(p, a);
+                cfg.preds.erase(a, p);
+                cfg.succs.insert(p, nb);
+                cfg.preds.insert(nb, p);
+            }
+            cfg.succs.insert(nb, a);
+            cfg.preds.insert(a, nb);
+            inc.insert_block(nb);
+        }
+        if(inc.idoms() != get_idom_lt(cfg)){
+            throw std::runtime_error("incremental idoms are wrong after edit " + std::to_string(e));
+        }
+    }
+}
+
+// every check on the cfg of one seed; returns an empty string if all pass
+static std::string check_seed(unsigned seed, int max_blocks, int edits){
+    std::mt19937 rng(seed);
+    Cfg cfg = random_cfg(rng, max_blocks);
+    try {
+        // both engines against each other, and the tree against the definition
+        Idom idom = get_idom_chk(cfg, get_rev_post_order(cfg));
+        if(idom != get_idom_lt(cfg)){
+            throw std::runtime_error("cooper-harvey-kennedy and lengauer-tarjan disagree");
+        }
+        DomTree tree(idom, cfg.entryIdx);
+        verify_dom_tree(tree, cfg);
+        check_frontier(cfg, tree, get_dom_frontier(idom, cfg));
+
+        // the same over the reverse cfg, for post-dominators
+        Cfg reverse = get_reverse_cfg(cfg);
+        Idom ipdom = get_ipdom(reverse);
+        if(ipdom != get_idom_lt(reverse)){
+            throw std::runtime_error("post-dominator engines disagree");
+        }
+        verify_dom_tree(DomTree(ipdom, reverse.entryIdx), reverse);
+
+        check_incremental(rng, cfg, edits);
+    } catch (const std::runtime_error& e) {
+        // the edits changed the cfg, so show it as generated
+        std::mt19937 again(seed);
+        return "seed " + std::to_string(seed) + ": " + e.what() + "\n  " + describe(random_cfg(again, max_blocks));
+    }
+    return "";
+}
+
+int main(int argc, char* argv[]) {
+    int jobs;
+    try {
+        jobs = take_jobs_arg(argc, argv);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // number of cfgs, their largest size, first seed, and edits per cfg for the incremental idoms
+    long num_cfgs = 100000;
+    int max_blocks = 20;
+    unsigned seed = 0;
+    int edits = 10;
+    bool bad_flag = false;
+    for (int i = 1; i < argc && !bad_flag; i++) {
+        std::string flag = argv[i];
+        try {
+            if (i + 1 == argc) bad_flag = true;
+            else if (flag == "-n") num_cfgs = std::stol(argv[++i]);
+            else if (flag == "-b") max_blocks = std::stoi(argv[++i]);
+            else if (flag == "-s") seed = std::stoul(argv[++i]);
+            else if (flag == "-e") edits = std::stoi(argv[++i]);
+            else bad_flag = true;
+        } catch (const std::exception&) {
+            bad_flag = true;
+        }
+    }
+    if (bad_flag || max_blocks < 1) {
+        std::cerr << "Usage: " << argv[0] << " [-n cfgs] [-b max blocks] [-s seed] [-e edits] [-j N]" << std::endl;
+        return 1;
+    }
+
+    // cfg i comes from seed + i, so a failure can be rerun alone with -n 1 -s <seed>
+    std::mutex lock;
+    std::string failure;
+    std::atomic<bool> failed = false;
+    {
+        ThreadPool pool(jobs);
+        for(int w = 0; w < jobs; w++){
+            pool.submit([&, w](){
+                for(long i = w; i < num_cfgs && !failed; i += jobs){
+                    std::string error = check_seed(seed + i, max_blocks, edits);
+                    if(error.empty()) continue;
+                    std::lock_guard<std::mutex> guard(lock);
+                    if(!failed) failure = error;
+                    failed = true;
+                }
+            });
+        }
+    }
+
+    if(failed){
+        std::cout << "ERROR: " << failure << std::endl;
+        return 1;
+    }
+    std::cout << num_cfgs << " cfgs ok" << std::endl;
+    return 0;
+}
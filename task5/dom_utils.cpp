@@ -1,20 +1,30 @@
 #include "dom_utils.hpp"
 
-void get_post_order(const Cfg& cfg, std::vector<int>& order, int cur_node, std::set<int>& visited){
-    if(visited.contains(cur_node)) return;
-    visited.insert(cur_node);
-
-    if(cfg.succs.contains(cur_node)){
-        for(int succ: cfg.succs.at(cur_node)){
-            get_post_order(cfg, order, succ, visited);
+void get_post_order(const Cfg& cfg, std::vector<int>& order, int cur_node, std::vector<bool>& visited){
+    if(visited[cur_node]) return;
+    visited[cur_node] = true;
+
+    // iterative dfs, so deep cfgs do not overflow the stack
+    std::vector<std::pair<int,int>> stack = {{cur_node, 0}}; // block and index of the next successor to visit
+    while(!stack.empty()){
+        auto& [b, next] = stack.back();
+        auto succs = cfg.succs.at(b);
+        if(next == succs.size()){
+            order.push_back(b);
+            stack.pop_back();
+            continue;
         }
+        int succ = succs[next++];
+        if(visited[succ]) continue;
+        visited[succ] = true;
+        stack.push_back({succ, 0});
     }
-    order.push_back(cur_node);
 }
 
 std::vector<int> get_rev_post_order(const Cfg& cfg){
     std::vector<int> order;
-    std::set<int> visited;
+    if(cfg.size() == 0) return order;
+    std::vector<bool> visited(cfg.size());
     get_post_order(cfg, order, cfg.entryIdx, visited);
     std::reverse(order.begin(), order.end());
     return order;
@@ -22,61 +32,170 @@ std::vector<int> get_rev_post_order(const Cfg& cfg){
 
 // get map of nodes to dominators
 Dom get_dom(const json& func){
-    Dom dom;
+    Cfg cfg = get_cfg_view(func);
+    return get_dom(cfg, get_rev_post_order(cfg));
+}
+
+Dom get_dom(const Cfg& cfg, const std::vector<int>& order){
+    return dom_from_idom(get_idom(cfg, order), cfg);
+}
 
-    // get CFG
-    Cfg cfg = get_cfg_func(func);
-    std::vector<Block>& blocks = cfg.blocks;
+Idom get_idom_chk(const Cfg& cfg, const std::vector<int>& order){
+    Idom idom(cfg.size(), -1);
+    if(order.empty()) return idom;
 
-    // init dom[every block] -> all blocks
-    std::set<int> init;
-    for(int i = 0; i < blocks.size(); i++){
-        init.insert(i);
-    } 
-    for(int i = 0; i < blocks.size(); i++){
-        dom[i] = init;
+    // number blocks by position in reverse postorder; a block's idom always comes before it
+    std::vector<int> rpo_num(cfg.size(), -1);
+    for(int k = 0; k < order.size(); k++){
+        rpo_num[order[k]] = k;
     }
 
-    // dom[entry] = entry
-    dom[cfg.entryIdx] = {cfg.entryIdx};
-
-    // get reverse postorder order
-    const auto& order = get_rev_post_order(cfg);
+    // walk two fingers up the idom tree until they meet at the nearest common dominator
+    auto intersect = [&](int a, int b){
+        while(a != b){
+            while(rpo_num[a] > rpo_num[b]) a = idom[a];
+            while(rpo_num[b] > rpo_num[a]) b = idom[b];
+        }
+        return a;
+    };
 
-    // iterate to convergence
+    // the entry is its own idom while iterating, so the walks stop there
+    int entry = order[0];
+    idom[entry] = entry;
     bool changed = true;
     while(changed){
         changed = false;
-
-        // iterate over nodes
-        for(int i = 0; i < order.size(); i++){   
-            if(i == cfg.entryIdx) continue;   
-            auto& preds = cfg.preds.at(i);
-
-            std::set<int> dom_new;
-            auto it = preds.begin();
-            if(preds.size()>0) dom_new = dom[*it];
-            it++;
-
-            // get union over preds
-            for(; it != preds.end(); it++){
-                int p = *it;
-                std::set<int> temp;
-                std::set_intersection(dom_new.begin(), dom_new.end(),
-                                      dom[p].begin(), dom[p].end(),
-                                      std::inserter(temp, temp.end()));
-                dom_new = std::move(temp);
+        for(int k = 1; k < order.size(); k++){
+            int b = order[k];
+
+            // intersect over the preds already given an idom; unreachable ones never are
+            int new_idom = -1;
+            for(int p: cfg.preds.at(b)){
+                if(idom[p] == -1) continue;
+                new_idom = new_idom == -1 ? p : intersect(p, new_idom);
             }
+            if(idom[b] != new_idom){
+                idom[b] = new_idom;
+                changed = true;
+            }
+        }
+    }
+    idom[entry] = -1;
+    return idom;
+}
+
+Idom get_idom_lt(const Cfg& cfg){
+    int n = cfg.size();
+    Idom idom(n, -1);
+    if(n == 0) return idom;
+
+    // number the blocks reachable from the entry in dfs preorder, keeping the dfs tree
+    std::vector<int> dfnum(n, -1);
+    std::vector<int> vertex;
+    std::vector<int> parent(n, -1);
+    std::vector<std::pair<int,int>> stack; // block and index of the next successor to visit
+    dfnum[cfg.entryIdx] = 0;
+    vertex.push_back(cfg.entryIdx);
+    stack.push_back({cfg.entryIdx, 0});
+    while(!stack.empty()){
+        auto& [b, next] = stack.back();
+        auto succs = cfg.succs.at(b);
+        if(next == succs.size()){
+            stack.pop_back();
+            continue;
+        }
+        int s = succs[next++];
+        if(dfnum[s] != -1) continue;
+        dfnum[s] = vertex.size();
+        vertex.push_back(s);
+        parent[s] = b;
+        stack.push_back({s, 0});
+    }
+
+    // semi[b] is the dfnum of the semidominator of b; [ancestor] is the forest of blocks linked so
+    // far, and best[b] the block of lowest semi on the path up to its root
+    std::vector<int> semi(n, -1);
+    std::vector<int> ancestor(n, -1);
+    std::vector<int> best(n);
+    std::vector<int> samedom(n, -1);
+    std::vector<int> bucket_head(n, -1);
+    std::vector<int> bucket_next(n, -1);
+    for(int b = 0; b < n; b++){
+        semi[b] = dfnum[b];
+        best[b] = b;
+    }
 
-            // insert self
-            dom_new.insert(i);
-            
-            // update dom[self]
-            if(dom_new != dom[i]) changed = true;
-            dom[i] = dom_new;
+    // block of lowest semi between [v] (linked) and the root of its tree, compressing the path; the
+    // path is collected first so deep trees do not recurse
+    std::vector<int> path;
+    auto lowest_semi = [&](int v){
+        path.clear();
+        for(int x = v; ancestor[ancestor[x]] != -1; x = ancestor[x]){
+            path.push_back(x);
+        }
+        for(int j = path.size()-1; j >= 0; j--){
+            int x = path[j];
+            int a = ancestor[x];
+            if(semi[best[a]] < semi[best[x]]) best[x] = best[a];
+            ancestor[x] = ancestor[a];
+        }
+        return best[v];
+    };
+
+    for(int i = vertex.size()-1; i > 0; i--){
+        int w = vertex[i];
+        int p = parent[w];
+
+        // the semidominator is the lowest numbered block from which a path reaches w through
+        // blocks numbered above w
+        int s = dfnum[p];
+        for(int v: cfg.preds.at(w)){
+            if(dfnum[v] == -1) continue;
+            int cand = dfnum[v] <= dfnum[w] ? dfnum[v] : semi[lowest_semi(v)];
+            s = std::min(s, cand);
+        }
+        semi[w] = s;
+        bucket_next[w] = bucket_head[vertex[s]];
+        bucket_head[vertex[s]] = w;
+        ancestor[w] = p;
+
+        // blocks whose semidominator is p: their idom is p, or the same as that of a block below
+        for(int v = bucket_head[p]; v != -1; v = bucket_next[v]){
+            int y = lowest_semi(v);
+            if(semi[y] == semi[v]) idom[v] = p;
+            else samedom[v] = y;
         }
+        bucket_head[p] = -1;
+    }
+    for(int i = 1; i < vertex.size(); i++){
+        int w = vertex[i];
+        if(samedom[w] != -1) idom[w] = idom[samedom[w]];
+    }
+    return idom;
+}
+
+Idom get_idom(const Cfg& cfg, const std::vector<int>& order){
+    return cfg.size() >= LT_MIN_BLOCKS ? get_idom_lt(cfg) : get_idom_chk(cfg, order);
+}
+
+Dom dom_from_idom(const Idom& idom, const Cfg& cfg){
+    Dom dom;
+    std::set<int> all_blocks;
+    for(int b = 0; b < cfg.size(); b++){
+        all_blocks.insert(all_blocks.end(), b);
     }
 
+    for(int b = 0; b < cfg.size(); b++){
+        // every block dominates one the entry does not reach
+        if(b != cfg.entryIdx && idom[b] == -1){
+            dom[b] = all_blocks;
+            continue;
+        }
+        auto& doms = dom[b];
+        for(int d = b; d != -1; d = idom[d]){
+            doms.insert(d);
+        }
+    }
     return dom;
 }
 
@@ -91,39 +210,54 @@ void print_dom(const DomBase& dom, const Cfg& cfg){
     }
 }
 
-/* This method verifies that dominators given by the Dom struct for a node do indeed dominate that node. */
-void verify_dominators(const Dom& dom, const Cfg& cfg) {
-    for (const auto& [block, dominators] : dom) {
-        for (int dominator : dominators) {
-            if (dominator == cfg.entryIdx) continue;
-
-            // BFS from entry point, terminate when dominator is found
-            std::queue<int> queue(std::queue<int>::container_type(cfg.entryIdx));
-            std::set<int> seen{cfg.entryIdx};
-            while (!queue.empty()) {
-                int current = queue.front(); queue.pop();
-
-                // prune branches if dominator is reached
-                if (current == dominator) continue;
-
-                // If block is found then throw an exception
-                if (current == block) {
-                    throw std::runtime_error(
-                        "block "
-                        + get_block_name(cfg, dominator)
-                        + " is supposed to dominate " 
-                        + get_block_name(cfg, block)
-                        + " but a path to it from entry was found."
-                    );
-                }
-
-                for (int succ : cfg.succs.at(current)) {
-                    if (seen.find(succ) != seen.end()) continue;
-                    seen.insert(succ);
-                    queue.push(succ);
-                }
+void print_dom(const Adjacency& rows, const Cfg& cfg){
+    for(int b = 0; b < rows.size(); b++){
+        std::cout << get_block_name(cfg, b) << ": ";
+        for(int t: rows.at(b)){
+            std::cout << get_block_name(cfg, t) << " ";
+        }
+        std::cout << std::endl;
+    }
+}
+
+// name of [b], or its number in a cfg without block contents such as a reverse cfg
+static std::string verify_name(const Cfg& cfg, int b){
+    bool has_block = cfg.instrs ? b < cfg.ranges.size() : b < cfg.blocks.size();
+    return has_block ? get_block_name(cfg, b) : "b" + std::to_string(b);
+}
+
+void verify_dom_tree(const DomTree& tree, const Cfg& cfg){
+    int n = cfg.size();
+    std::vector<bool> reached(n);
+    std::vector<int> stack;
+    for(int d = 0; d < n; d++){
+        // flood from the entry with [d] taken out; what is left unreached is what [d] dominates
+        std::fill(reached.begin(), reached.end(), false);
+        if(d != cfg.entryIdx){
+            reached[cfg.entryIdx] = true;
+            stack.push_back(cfg.entryIdx);
+        }
+        while(!stack.empty()){
+            int b = stack.back();
+            stack.pop_back();
+            for(int s: cfg.succs.at(b)){
+                if(s == d || reached[s]) continue;
+                reached[s] = true;
+                stack.push_back(s);
             }
         }
+
+        for(int b = 0; b < n; b++){
+            bool dominated = b == d || !reached[b];
+            if(tree.dominates(d, b) == dominated) continue;
+            throw std::runtime_error(
+                "block "
+                + verify_name(cfg, d)
+                + (dominated ? " dominates " : " does not dominate ")
+                + verify_name(cfg, b)
+                + " but the dominator tree says otherwise."
+            );
+        }
     }
 }
 
@@ -137,107 +271,439 @@ Dom get_inverse_dom(const Dom& dom){
     return inverse_dom;
 }
 
-DomTree get_dom_tree(const Dom& dom, const Cfg& cfg){
-    DomTree dom_tree;
-    Dom inverse_dom = get_inverse_dom(dom);
+DomTree::DomTree(const Idom& idom, int entry) : idom(idom) {
+    int n = idom.size();
+    std::vector<std::pair<int,int>> edges;
+    for(int b = 0; b < n; b++){
+        if(idom[b] != -1) edges.push_back({idom[b], b});
+    }
+    children = Adjacency(n, edges);
+
+    // number the tree under the entry; blocks left unnumbered are unreachable. the dfs is
+    // iterative so deep trees do not recurse
+    pre.assign(n, -1);
+    post.assign(n, -1);
+    if(n == 0) return;
+    int root = entry;
+    int clock = 0;
+    std::vector<std::pair<int,int>> stack; // block and index of the next child to visit
+    pre[root] = clock++;
+    stack.push_back({root, 0});
+    while(!stack.empty()){
+        auto& [b, next] = stack.back();
+        auto kids = children.at(b);
+        if(next == kids.size()){
+            post[b] = clock++;
+            stack.pop_back();
+            continue;
+        }
+        int c = kids[next++];
+        pre[c] = clock++;
+        stack.push_back({c, 0});
+    }
+
+    // ancestor tables by doubling; the root is its own ancestor so lifts stop there
+    levels = 1;
+    while((1 << levels) < n) levels++;
+    up.assign(levels * n, root);
+    for(int b = 0; b < n; b++){
+        if(idom[b] != -1) up[b] = idom[b];
+    }
+    for(int k = 1; k < levels; k++){
+        for(int b = 0; b < n; b++){
+            up[k*n + b] = up[(k-1)*n + up[(k-1)*n + b]];
+        }
+    }
+}
+
+int DomTree::nearest_common_dominator(int a, int b) const {
+    if(!reachable(a) || !reachable(b)) return -1;
+    if(dominates(a, b)) return a;
+
+    // lift a to the highest ancestor not dominating b; its idom is the answer
+    int n = size();
+    for(int k = levels-1; k >= 0; k--){
+        int u = up[k*n + a];
+        if(!dominates(u, b)) a = u;
+    }
+    return idom[a];
+}
+
+DomTree get_dom_tree(const Idom& idom, int entry){
+    return DomTree(idom, entry);
+}
+
+IncrementalDom::IncrementalDom(const Cfg& cfg) : cfg(cfg) {
+    reset();
+}
+
+void IncrementalDom::grow(){
+    int n = cfg.size();
+    if(idom.size() >= n) return;
+    idom.resize(n, -1);
+    depths.resize(n, -1);
+    children.resize(n);
+    stamp.resize(n, 0);
+    pos.resize(n, -1);
+}
+
+void IncrementalDom::reset(){
+    int n = cfg.size();
+    std::vector<int> order = get_rev_post_order(cfg);
+    root = cfg.entryIdx;
+    idom = get_idom(cfg, order);
+    depths.assign(n, -1);
+    children.assign(n, {});
+    stamp.assign(n, 0);
+    pos.assign(n, -1);
+    num_rebuilt += n;
+    if(n == 0) return;
+
+    // idoms come before their blocks in reverse postorder
+    depths[root] = 0;
+    for(int b: order){
+        if(b == root) continue;
+        depths[b] = depths[idom[b]] + 1;
+        children[idom[b]].push_back(b);
+    }
+}
+
+bool IncrementalDom::dominates(int a, int b) const {
+    if(!reachable(b)) return true;
+    if(!reachable(a)) return false;
+    while(depths[b] > depths[a]) b = idom[b];
+    return a == b;
+}
+
+int IncrementalDom::nearest_common_dominator(int a, int b) const {
+    if(!reachable(a) || !reachable(b)) return -1;
+    while(depths[a] > depths[b]) a = idom[a];
+    while(depths[b] > depths[a]) b = idom[b];
+    while(a != b){
+        a = idom[a];
+        b = idom[b];
+    }
+    return a;
+}
+
+void IncrementalDom::insert_edge(int from, int to){
+    grow();
+    if(cfg.entryIdx != root) return reset();
+    if(!reachable(from)) return;
 
-    for(const auto& cur: inverse_dom){
-        int node = cur.first;
-        inverse_dom.at(node).erase(node);
+    // a new edge only lowers the idoms of blocks below the nearest common dominator of its ends,
+    // and none if [to] is already a child of it
+    if(reachable(to)){
+        int d = nearest_common_dominator(from, to);
+        if(d != to && d != idom[to]) rebuild(d, {});
+        return;
     }
 
-    // for each node find nodes strictly dominated by children of node
-    Dom children_dom = inverse_dom;
-    for(const auto& cur: children_dom){
-        int node = cur.first;
-        std::set<int> children;
-        for(int child: cur.second){
-            std::set<int> temp;
-            std::set_union(children.begin(), children.end(),
-                           inverse_dom.at(child).begin(), inverse_dom.at(child).end(),
-                           std::inserter(temp, temp.end()));
-            children = std::move(temp);
+    // [to] is reached for the first time, along with what only it leads to; their edges back into
+    // the reached blocks count as new edges too
+    std::vector<int> reached = {to};
+    stamp[to] = ++gen;
+    int d = from;
+    for(int k = 0; k < reached.size(); k++){
+        for(int s: cfg.succs.at(reached[k])){
+            if(reachable(s)){
+                d = nearest_common_dominator(d, s);
+            } else if(stamp[s] != gen){
+                stamp[s] = gen;
+                reached.push_back(s);
+            }
         }
-        children_dom[node] = children;
     }
+    rebuild(d, reached);
+}
 
-    // find domtree, filter nodes
-    for(const auto& cur: inverse_dom){
-        std::set<int> immediate;
-        for(int node: cur.second){
-            // if node not in children_dom
-            if(!children_dom[cur.first].contains(node)){
-                immediate.insert(node);
+void IncrementalDom::delete_edge(int from, int to){
+    grow();
+    if(cfg.entryIdx != root) return reset();
+    if(!reachable(from) || !reachable(to)) return;
+
+    // a lost edge only raises the idoms of blocks below the nearest common dominator of its ends;
+    // an edge back into a dominator is on no simple path from the entry
+    int d = nearest_common_dominator(from, to);
+    if(d == to) return;
+
+    // blocks the rebuild left unreached no longer lead anywhere, which is as if their edges out of
+    // the region were lost too, so the region grows until none are
+    while(true){
+        int top = d;
+        for(int u: rebuild(d, {})){
+            for(int s: cfg.succs.at(u)){
+                if(stamp[s] != gen && reachable(s)) top = nearest_common_dominator(top, s);
             }
         }
-        dom_tree[cur.first] = immediate;
+        if(top == d) break;
+        d = top;
     }
+}
 
-    return dom_tree;
+void IncrementalDom::insert_block(int b){
+    grow();
+    if(cfg.entryIdx != root) return reset();
+
+    // the edges into [b] used to go to its successor, so every block involved is below the nearest
+    // common dominator of both
+    int d = -1;
+    for(int p: cfg.preds.at(b)){
+        if(reachable(p)) d = d == -1 ? p : nearest_common_dominator(d, p);
+    }
+    if(d == -1) return;
+    for(int s: cfg.succs.at(b)){
+        if(reachable(s)) d = nearest_common_dominator(d, s);
+    }
+    rebuild(d, {b});
 }
 
-DomFrontier get_dom_frontier(const Dom& dom, const Cfg& cfg){
-    DomFrontier front;
-    auto inverse_dom = get_inverse_dom(dom);
+std::vector<int> IncrementalDom::rebuild(int d, const std::vector<int>& extra){
+    // gather the region, detaching every block in it but [d] from the tree
+    std::vector<int> region = {d};
+    gen++;
+    stamp[d] = gen;
+    for(int k = 0; k < region.size(); k++){
+        for(int c: children[region[k]]){
+            stamp[c] = gen;
+            region.push_back(c);
+        }
+    }
+    for(int b: extra){
+        stamp[b] = gen;
+        region.push_back(b);
+    }
+    for(int b: region){
+        children[b].clear();
+        pos[b] = -1;
+        if(b == d) continue;
+        idom[b] = -1;
+        depths[b] = -1;
+    }
+    num_rebuilt += region.size();
 
-    for(const auto& cur: inverse_dom){
-        int cur_node = cur.first;
-        front[cur_node];
+    // reverse postorder of the region from [d]; every path into it from the rest of the cfg goes
+    // through [d], so the rest can be left out
+    std::vector<int> order;
+    std::vector<std::pair<int,int>> stack = {{d, 0}};
+    pos[d] = 0;
+    while(!stack.empty()){
+        auto& [b, next] = stack.back();
+        auto succs = cfg.succs.at(b);
+        if(next == succs.size()){
+            order.push_back(b);
+            stack.pop_back();
+            continue;
+        }
+        int s = succs[next++];
+        if(stamp[s] != gen || pos[s] != -1) continue;
+        pos[s] = 0;
+        stack.push_back({s, 0});
+    }
+    std::reverse(order.begin(), order.end());
+    for(int k = 0; k < order.size(); k++){
+        pos[order[k]] = k;
+    }
 
-        for(int dominated: inverse_dom[cur_node]){
-            for(int succ: cfg.succs.at(dominated)){
-                if(succ == cur_node || !inverse_dom.at(cur_node).contains(succ)){
-                    // insert into dom frontier
-                    front[cur_node].insert(succ);
-                }
+    // cooper, harvey and kennedy over the region, by position in [order]
+    std::vector<int> ip(order.size(), -1);
+    ip[0] = 0;
+    auto intersect = [&](int a, int b){
+        while(a != b){
+            while(a > b) a = ip[a];
+            while(b > a) b = ip[b];
+        }
+        return a;
+    };
+    bool changed = true;
+    while(changed){
+        changed = false;
+        for(int k = 1; k < order.size(); k++){
+            int new_ip = -1;
+            for(int p: cfg.preds.at(order[k])){
+                if(stamp[p] != gen || pos[p] == -1 || ip[pos[p]] == -1) continue;
+                new_ip = new_ip == -1 ? pos[p] : intersect(pos[p], new_ip);
+            }
+            if(ip[k] != new_ip){
+                ip[k] = new_ip;
+                changed = true;
             }
         }
     }
 
-    return front;
+    for(int k = 1; k < order.size(); k++){
+        int b = order[k];
+        int parent = order[ip[k]];
+        idom[b] = parent;
+        depths[b] = depths[parent] + 1;
+        children[parent].push_back(b);
+    }
+
+    std::vector<int> unreached;
+    for(int b: region){
+        if(pos[b] == -1) unreached.push_back(b);
+    }
+    return unreached;
 }
 
-void find_all_paths(const Cfg& cfg, int current, int target, std::set<int> current_path, std::set<std::set<int>>& all_paths) {
-    current_path.insert(current);
-    if (current == target) {
-        all_paths.insert(current_path);
-        return;
+DomFrontier get_dom_frontier(const Idom& idom, const Cfg& cfg){
+    // the entry is the one reachable block without an idom
+    auto reachable = [&](int b){ return b == cfg.entryIdx || idom[b] != -1; };
+
+    std::vector<std::pair<int,int>> edges;
+    for(int b = 0; b < cfg.size(); b++){
+        if(!reachable(b)) continue;
+        for(int p: cfg.preds.at(b)){
+            if(!reachable(p)) continue;
+            for(int runner = p; runner != idom[b]; runner = idom[runner]){
+                edges.push_back({runner, b});
+            }
+        }
     }
-    for (int next : cfg.succs.at(current)) {
-        if (current_path.contains(next)) continue;
-        find_all_paths(cfg, next, target, current_path, all_paths);
-    }
-}
-
-Dom find_dominators_brute_force(const Cfg& cfg) {
-    Dom dominators;
-    for (const auto& [block, _] : cfg.succs) {
-        std::transform(
-            cfg.succs.begin(), 
-            cfg.succs.end(), 
-            std::inserter(dominators[block], dominators[block].begin()), 
-            [](const auto& pair) { return pair.first; }
-        );
-    }
-    dominators[cfg.entryIdx] = {cfg.entryIdx};
-
-    for (const auto& [block, succs] : cfg.succs) {
-        if (block == cfg.entryIdx) continue;
-
-        std::set<std::set<int>> all_paths;
-        find_all_paths(cfg, cfg.entryIdx, block, {}, all_paths);
-        for (const std::set<int>& path : all_paths) {
-            std::set<int> intersection;
-            std::set_intersection(
-                dominators[block].begin(), 
-                dominators[block].end(), 
-                path.begin(), 
-                path.end(), 
-                std::inserter(intersection, intersection.begin())
-            );
-            dominators[block] = intersection;
+    return DomFrontier(cfg.size(), edges);
+}
+
+Cfg get_reverse_cfg(const Cfg& cfg){
+    int n = cfg.size();
+    int exit = n;
+    std::vector<std::pair<int,int>> edges;
+    for(int b = 0; b < n; b++){
+        auto succs = cfg.succs.at(b);
+        if(succs.empty()) edges.push_back({exit, b});
+        for(int s: succs){
+            edges.push_back({s, b});
+        }
+    }
+
+    // blocks that cannot reach the exit, as in an infinite loop, get an edge from it as well; the
+    // highest numbered one is picked each time and everything reaching it is then covered
+    std::vector<bool> reached(n+1);
+    std::vector<int> stack;
+    auto flood = [&](const Adjacency& rev, int from){
+        reached[from] = true;
+        stack.push_back(from);
+        while(!stack.empty()){
+            int b = stack.back();
+            stack.pop_back();
+            for(int s: rev.at(b)){
+                if(reached[s]) continue;
+                reached[s] = true;
+                stack.push_back(s);
+            }
+        }
+    };
+    Adjacency partial(n+1, edges);
+    flood(partial, exit);
+    bool added = false;
+    for(int b = n-1; b >= 0; b--){
+        if(reached[b]) continue;
+        edges.push_back({exit, b});
+        added = true;
+        flood(partial, b);
+    }
+
+    Cfg reverse;
+    reverse.succs = added ? Adjacency(n+1, edges) : std::move(partial);
+    reverse.preds = reverse.succs.transpose();
+    reverse.entryIdx = exit;
+    for(int b = 0; b <= n; b++){
+        reverse.block_order.push_back(b);
+    }
+    return reverse;
+}
+
+Idom get_ipdom(const Cfg& reverse){
+    return get_idom(reverse, get_rev_post_order(reverse));
+}
+
+Adjacency get_control_deps(const Cfg& reverse, const Idom& ipdom){
+    int n = reverse.size() - 1;
+    DomFrontier pdf = get_dom_frontier(ipdom, reverse);
+    std::vector<std::pair<int,int>> edges;
+    for(int b = 0; b < n; b++){
+        for(int a: pdf.at(b)){
+            edges.push_back({a, b});
+        }
+    }
+    return Adjacency(n, edges);
+}
+
+bool LoopForest::contains(int l, int b) const {
+    for(int x = loop_of[b]; x != -1; x = loops[x].parent){
+        if(x == l) return true;
+    }
+    return false;
+}
+
+LoopForest get_loop_forest(const Cfg& cfg, const DomTree& tree){
+    int n = cfg.size();
+    LoopForest forest;
+    forest.loop_of.assign(n, -1);
+
+    // one loop per header, over every back edge into it from a reachable block
+    std::vector<int> mark(n, -1);
+    std::vector<int> stack;
+    for(int h = 0; h < n; h++){
+        std::vector<int> latches;
+        for(int p: cfg.preds.at(h)){
+            if(tree.reachable(p) && tree.dominates(h, p)) latches.push_back(p);
+        }
+        if(latches.empty()) continue;
+
+        // the body is every block reaching a latch without passing through the header
+        int l = forest.loops.size();
+        Loop& loop = forest.loops.emplace_back();
+        loop.header = h;
+        loop.latches = latches;
+        mark[h] = l;
+        loop.blocks.push_back(h);
+        for(int p: latches){
+            if(mark[p] == l) continue;
+            mark[p] = l;
+            loop.blocks.push_back(p);
+            stack.push_back(p);
+        }
+        while(!stack.empty()){
+            int b = stack.back();
+            stack.pop_back();
+            for(int p: cfg.preds.at(b)){
+                if(mark[p] == l || !tree.reachable(p)) continue;
+                mark[p] = l;
+                loop.blocks.push_back(p);
+                stack.push_back(p);
+            }
+        }
+        std::sort(loop.blocks.begin(), loop.blocks.end());
+
+        for(int b: loop.blocks){
+            for(int s: cfg.succs.at(b)){
+                if(mark[s] != l) loop.exits.push_back(s);
+            }
+        }
+        std::sort(loop.exits.begin(), loop.exits.end());
+        loop.exits.erase(std::unique(loop.exits.begin(), loop.exits.end()), loop.exits.end());
+    }
+
+    // natural loops are nested or disjoint, and an outer loop is larger than any inside it; going
+    // largest first, the loop a header is in by then is the innermost one around it
+    std::vector<int> by_size(forest.loops.size());
+    std::iota(by_size.begin(), by_size.end(), 0);
+    std::stable_sort(by_size.begin(), by_size.end(), [&](int a, int b){
+        return forest.loops[a].blocks.size() > forest.loops[b].blocks.size();
+    });
+    for(int l: by_size){
+        Loop& loop = forest.loops[l];
+        loop.parent = forest.loop_of[loop.header];
+        loop.depth = loop.parent == -1 ? 1 : forest.loops[loop.parent].depth + 1;
+        for(int b: loop.blocks){
+            forest.loop_of[b] = l;
         }
     }
+    return forest;
+}
 
-    return dominators;
-}
\ No newline at end of file
+PreservedAnalyses preserve_cfg_shape(){
+    return PreservedAnalyses().preserve<RevPostOrderAnalysis, IdomAnalysis, DomAnalysis, DomTreeAnalysis, DomFrontierAnalysis,
+                                        LoopForestAnalysis, ReverseCfgAnalysis, PostIdomAnalysis, PostDomTreeAnalysis,
+                                        ControlDepAnalysis>();
+}
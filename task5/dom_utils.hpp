@@ -6,6 +6,7 @@
 #include <numeric>
 #include <queue>
 #include <set>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
@@ -13,32 +14,239 @@
 #include <nlohmann/json.hpp>
 
 #include "../task2/cfg/cfg_utils.hpp"
+#include "../task2/cfg/analysis_manager.hpp"
 
 
 using DomBase = std::unordered_map<int,std::set<int>>;
 using Dom = DomBase;
-using DomTree = DomBase;
-using DomFrontier = DomBase;
 
-// get postorder traversal order
-void get_post_order(const Cfg& cfg, std::vector<int>& order, int cur_node, std::set<int>& visited);
+// dominance frontier of each block, as rows indexed by block
+using DomFrontier = Adjacency;
+
+// get postorder traversal order of the blocks [cur_node] reaches that are not yet [visited]
+void get_post_order(const Cfg& cfg, std::vector<int>& order, int cur_node, std::vector<bool>& visited);
 
 // get reversed postorder traversal order
 std::vector<int> get_rev_post_order(const Cfg& cfg);
 
+// immediate dominator of each block, -1 for the entry and for blocks it does not reach
+using Idom = std::vector<int>;
+
+// cfgs of at least this many blocks get their idoms from lengauer-tarjan
+constexpr int LT_MIN_BLOCKS = 1000;
+
+// idoms by the iterative algorithm of cooper, harvey and kennedy over reverse postorder [order]:
+// each block's idom is the nearest common dominator of its processed preds, found by walking up
+// the idoms so far. a few passes over the cfg suffice for the usual reducible ones
+Idom get_idom_chk(const Cfg& cfg, const std::vector<int>& order);
+
+// idoms by lengauer-tarjan with path compression, O(e log n) whatever the shape of the cfg
+Idom get_idom_lt(const Cfg& cfg);
+
+// idoms by whichever of the two suits the size of [cfg]
+Idom get_idom(const Cfg& cfg, const std::vector<int>& order);
+
+// dominator sets of each block, walking up the idoms; every block dominates an unreachable one
+Dom dom_from_idom(const Idom& idom, const Cfg& cfg);
+
 // get map of nodes to dominators
 Dom get_dom(const json& func);
 
+// same, over [cfg] visited in reverse postorder [order]
+Dom get_dom(const Cfg& cfg, const std::vector<int>& order);
+
 // display nodes and dominators
 void print_dom(const DomBase& dom, const Cfg& cfg);
 
-/* This method verifies that dominators given by the Dom struct for a node do indeed dominate that node. */
-void verify_dominators(const Dom& dom, const Cfg& cfg);
+// same, for a tree or frontier
+void print_dom(const Adjacency& rows, const Cfg& cfg);
+
 
 Dom get_inverse_dom(const Dom& dom);
 
-DomTree get_dom_tree(const Dom& dom, const Cfg& cfg);
+// dominator tree from the idoms: each block is a child of its idom, so blocks the entry does not
+// reach are no block's child. the tree is numbered by a dfs, pre and post, so that a dominates b
+// when b's interval lies in a's, and keeps 2^k-th ancestors for nearest common dominators
+class DomTree {
+public:
+    DomTree() = default;
+    DomTree(const Idom& idom, int entry);
+
+    int size() const { return idom.size(); }
+    std::span<const int> at(int b) const { return children.at(b); }
+    const Adjacency& rows() const { return children; }
+    int parent(int b) const { return idom[b]; }
+    bool reachable(int b) const { return pre[b] != -1; }
+
+    // as dom_from_idom has it, every block dominates one the entry does not reach
+    bool dominates(int a, int b) const {
+        return !reachable(b) || (reachable(a) && pre[a] <= pre[b] && post[b] <= post[a]);
+    }
+    bool strictly_dominates(int a, int b) const { return a != b && dominates(a, b); }
+
+    // deepest block dominating both [a] and [b], -1 if either is unreachable
+    int nearest_common_dominator(int a, int b) const;
+
+private:
+    Idom idom;
+    Adjacency children;
+    std::vector<int> pre;
+    std::vector<int> post;
+    std::vector<int> up; // up[k*size()+b] is the 2^k-th ancestor of b, the root past the top
+    int levels = 0;
+};
+
+DomTree get_dom_tree(const Idom& idom, int entry);
+
+// idoms of a cfg kept current while a pass edits it. after each edit to [cfg], tell it what changed;
+// only the dominator subtree under the nearest common dominator of the blocks involved is rebuilt,
+// since no block outside it can change idom, unless a deletion leaves part of it unreached and so
+// widens it. a new entry rebuilds everything
+class IncrementalDom {
+public:
+    explicit IncrementalDom(const Cfg& cfg);
+
+    const Idom& idoms() const { return idom; }
+    int parent(int b) const { return idom[b]; }
+    int depth(int b) const { return depths[b]; }
+    bool reachable(int b) const { return b == root || idom[b] != -1; }
+
+    // as DomTree has it, every block dominates one the entry does not reach; O(depth)
+    bool dominates(int a, int b) const;
+    int nearest_common_dominator(int a, int b) const;
+
+    // snapshot for constant time queries
+    DomTree tree() const { return DomTree(idom, root); }
+
+    // the edge [from] -> [to] was added to or removed from the cfg
+    void insert_edge(int from, int to);
+    void delete_edge(int from, int to);
+
+    // new block [b] took over edges into its successor, as insert_block_before and split_edge do
+    void insert_block(int b);
+
+    // number of blocks whose idom was recomputed so far
+    int rebuilt() const { return num_rebuilt; }
+
+private:
+    const Cfg& cfg;
+    int root = -1;
+    Idom idom;
+    std::vector<int> depths; // -1 for blocks the entry does not reach
+    std::vector<std::vector<int>> children;
+    std::vector<int> stamp; // blocks of the region being rebuilt carry the current [gen]
+    std::vector<int> pos;
+    int gen = 0;
+    int num_rebuilt = 0;
+
+    void grow();
+    void reset();
+
+    // recompute the idoms of [d]'s subtree and of the [extra] blocks, not yet in the tree, with [d]
+    // kept as their root; returns the blocks of the region [d] no longer reaches
+    std::vector<int> rebuild(int d, const std::vector<int>& extra);
+};
+
+// dominance frontiers by the runner walk of cooper, harvey and kennedy: each reachable pred of a
+// block walks up the idoms to the block's idom, and the block is in the frontier of every block
+// passed on the way
+DomFrontier get_dom_frontier(const Idom& idom, const Cfg& cfg);
+
+// check [tree] against the definition of dominance, one block at a time: a block dominates exactly
+// the blocks the entry no longer reaches once it is taken out. O(n·e); throws std::runtime_error
+// on the first pair that disagrees
+void verify_dom_tree(const DomTree& tree, const Cfg& cfg);
+
+// reverse of [cfg] with a synthetic exit, numbered cfg.size(), as its entry. the exit leads to every
+// block without successors, and to one block of each region that never reaches one, so the exit
+// post-dominates every block
+Cfg get_reverse_cfg(const Cfg& cfg);
+
+// immediate post-dominators, as idoms over [reverse] from get_reverse_cfg; a block only the exit
+// post-dominates has the exit as its ipdom
+Idom get_ipdom(const Cfg& reverse);
+
+// control dependence graph: a row for each block of the original cfg, listing the blocks control
+// dependent on it, those whose post-dominance frontier it is in. a block depends on a branch when
+// one side of the branch always leads to it but the other need not
+Adjacency get_control_deps(const Cfg& reverse, const Idom& ipdom);
+
+// natural loop of one header, merging the bodies of every back edge into it
+struct Loop {
+    int header;
+    std::vector<int> blocks;  // sorted, header included
+    std::vector<int> latches; // sorted sources of the back edges
+    std::vector<int> exits;   // sorted blocks outside the loop entered from it
+    int parent = -1;          // innermost loop around this one
+    int depth = 1;
+};
+
+// loops of a cfg and how they nest; blocks the entry does not reach are in no loop
+struct LoopForest {
+    std::vector<Loop> loops; // in order of header
+    std::vector<int> loop_of; // innermost loop of each block, -1 if none
+
+    // number of loops around [b]
+    int depth(int b) const { return loop_of[b] == -1 ? 0 : loops[loop_of[b]].depth; }
+
+    // whether [b] is in loop [l] or a loop nested in it
+    bool contains(int l, int b) const;
+};
+
+// loops over the back edges of [cfg], those into a block dominating their source
+LoopForest get_loop_forest(const Cfg& cfg, const DomTree& tree);
+
+// cached analyses; all of them depend only on the shape of the cfg, so a pass that keeps every
+// block and edge can preserve them with preserve_cfg_shape
+struct RevPostOrderAnalysis {
+    using Result = std::vector<int>;
+    static Result run(const json&, AnalysisManager& am) { return get_rev_post_order(am.get<CfgAnalysis>()); }
+};
+
+struct IdomAnalysis {
+    using Result = Idom;
+    static Result run(const json&, AnalysisManager& am) { return get_idom(am.get<CfgAnalysis>(), am.get<RevPostOrderAnalysis>()); }
+};
+
+struct DomAnalysis {
+    using Result = Dom;
+    static Result run(const json&, AnalysisManager& am) { return dom_from_idom(am.get<IdomAnalysis>(), am.get<CfgAnalysis>()); }
+};
+
+struct DomTreeAnalysis {
+    using Result = DomTree;
+    static Result run(const json&, AnalysisManager& am) { return get_dom_tree(am.get<IdomAnalysis>(), am.get<CfgAnalysis>().entryIdx); }
+};
+
+struct DomFrontierAnalysis {
+    using Result = DomFrontier;
+    static Result run(const json&, AnalysisManager& am) { return get_dom_frontier(am.get<IdomAnalysis>(), am.get<CfgAnalysis>()); }
+};
+
+struct LoopForestAnalysis {
+    using Result = LoopForest;
+    static Result run(const json&, AnalysisManager& am) { return get_loop_forest(am.get<CfgAnalysis>(), am.get<DomTreeAnalysis>()); }
+};
+
+struct ReverseCfgAnalysis {
+    using Result = Cfg;
+    static Result run(const json&, AnalysisManager& am) { return get_reverse_cfg(am.get<CfgAnalysis>()); }
+};
+
+struct PostIdomAnalysis {
+    using Result = Idom;
+    static Result run(const json&, AnalysisManager& am) { return get_ipdom(am.get<ReverseCfgAnalysis>()); }
+};
+
+struct PostDomTreeAnalysis {
+    using Result = DomTree;
+    static Result run(const json&, AnalysisManager& am) { return get_dom_tree(am.get<PostIdomAnalysis>(), am.get<ReverseCfgAnalysis>().entryIdx); }
+};
 
-DomFrontier get_dom_frontier(const Dom& dom, const Cfg& cfg);
+struct ControlDepAnalysis {
+    using Result = Adjacency;
+    static Result run(const json&, AnalysisManager& am) { return get_control_deps(am.get<ReverseCfgAnalysis>(), am.get<PostIdomAnalysis>()); }
+};
 
-Dom find_dominators_brute_force(const Cfg& cfg);
\ No newline at end of file
+// analyses still valid after a pass that rewrote instructions but kept every block, label and edge
+PreservedAnalyses preserve_cfg_shape();
\ No newline at end of file
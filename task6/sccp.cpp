@@ -0,0 +1,31 @@
+#include "sccp_utils.hpp"
+#include "../task2/cfg/stream_utils.hpp"
+
+int main(int argc, char* argv[]) {
+    // number of functions to work on at once
+    int jobs;
+    try {
+        jobs = take_jobs_arg(argc, argv);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+    if (argc > 1) {
+        std::cerr << "Usage: " << argv[0] << " [-j N] < ssa program" << std::endl;
+        return 1;
+    }
+
+    // propagate constants through each function as it is read
+    void (*propagate)(json&) = sccp;
+    try {
+        transform_funcs(std::cin, std::cout, propagate, jobs);
+    } catch (const json::parse_error& e) {
+        std::cerr << "ERROR: Failed to parse JSON from stdin, " << e.what() << std::endl;
+        return 1;
+    } catch (const std::runtime_error& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,401 @@
+#include "sccp_utils.hpp"
+
+#include <cmath>
+
+using Level = SccpValue::Level;
+
+// the constant of a const instruction, by its declared type; bottom for types sccp does not fold
+static SccpValue const_of(const IrFunc& f, const Instr& instr){
+    if(!(instr.keys & KEY_TYPE)) return SccpValue::bottom();
+    const std::string& type = f.types.name(instr.type);
+    SccpValue v{Level::Const};
+    if(type == "int" && (instr.value_kind == ValueKind::Int || instr.value_kind == ValueKind::Uint)){
+        v.kind = ValueKind::Int;
+        v.value.i = instr.value_kind == ValueKind::Int ? instr.value.i : (int64_t) instr.value.u;
+    } else if(type == "float" && instr.value_kind != ValueKind::Bool && instr.value_kind != ValueKind::Char){
+        v.kind = ValueKind::Float;
+        v.value.f = instr.value_kind == ValueKind::Int ? instr.value.i
+                  : instr.value_kind == ValueKind::Uint ? instr.value.u : instr.value.f;
+    } else if(type == "bool" && instr.value_kind == ValueKind::Bool){
+        v.kind = ValueKind::Bool;
+        v.value.b = instr.value.b;
+    } else if(type == "char" && instr.value_kind == ValueKind::Char){
+        v.kind = ValueKind::Char;
+        v.value.c = instr.value.c;
+    } else {
+        return SccpValue::bottom();
+    }
+    return v;
+}
+
+static bool same_const(const SccpValue& a, const SccpValue& b){
+    if(a.kind != b.kind) return false;
+    switch(a.kind){
+        case ValueKind::Int: return a.value.i == b.value.i;
+        case ValueKind::Float: return a.value.f == b.value.f && std::signbit(a.value.f) == std::signbit(b.value.f);
+        case ValueKind::Bool: return a.value.b == b.value.b;
+        case ValueKind::Char: return a.value.c == b.value.c;
+        default: return false;
+    }
+}
+
+// cur = cur meet v; true if cur went down
+static bool lower(SccpValue& cur, const SccpValue& v){
+    if(v.level == Level::Top || cur.level == Level::Bottom) return false;
+    if(cur.level == Level::Top){
+        cur = v;
+        return true;
+    }
+    if(v.level == Level::Const && same_const(cur, v)) return false;
+    cur = SccpValue::bottom();
+    return true;
+}
+
+static SccpValue int_const(int64_t i){
+    SccpValue v{Level::Const, ValueKind::Int};
+    v.value.i = i;
+    return v;
+}
+
+static SccpValue bool_const(bool b){
+    SccpValue v{Level::Const, ValueKind::Bool};
+    v.value.b = b;
+    return v;
+}
+
+// a finite float result; inf and nan have no json spelling, so those stay unfolded
+static std::optional<SccpValue> float_const(double f){
+    if(!std::isfinite(f)) return std::nullopt;
+    SccpValue v{Level::Const, ValueKind::Float};
+    v.value.f = f;
+    return v;
+}
+
+// evaluate [op] on constant [args] with brili's semantics (wrapping 64-bit ints, doubles), nullopt
+// if the op is not folded or would fail at run time
+static std::optional<SccpValue> fold(const IrFunc& f, Opcode op, const std::vector<SccpValue>& args){
+    auto is = [&](ValueKind kind){
+        for(const auto& arg: args){
+            if(arg.kind != kind) return false;
+        }
+        return true;
+    };
+    auto wrap = [](uint64_t u){ return int_const((int64_t) u); };
+
+    if(is(ValueKind::Int) && args.size() == 2){
+        int64_t a = args[0].value.i, b = args[1].value.i;
+        switch(op){
+            case Opcode::Add: return wrap((uint64_t) a + (uint64_t) b);
+            case Opcode::Sub: return wrap((uint64_t) a - (uint64_t) b);
+            case Opcode::Mul: return wrap((uint64_t) a * (uint64_t) b);
+            case Opcode::Div:
+                if(b == 0) return std::nullopt;
+                if(a == INT64_MIN && b == -1) return int_const(INT64_MIN);
+                return int_const(a / b);
+            case Opcode::Eq: return bool_const(a == b);
+            case Opcode::Lt: return bool_const(a < b);
+            case Opcode::Gt: return bool_const(a > b);
+            case Opcode::Le: return bool_const(a <= b);
+            case Opcode::Ge: return bool_const(a >= b);
+            default: return std::nullopt;
+        }
+    }
+
+    if(is(ValueKind::Float) && args.size() == 2){
+        double a = args[0].value.f, b = args[1].value.f;
+        switch(op){
+            case Opcode::Fadd: return float_const(a + b);
+            case Opcode::Fsub: return float_const(a - b);
+            case Opcode::Fmul: return float_const(a * b);
+            case Opcode::Fdiv: return float_const(a / b);
+            case Opcode::Feq: return bool_const(a == b);
+            case Opcode::Flt: return bool_const(a < b);
+            case Opcode::Fgt: return bool_const(a > b);
+            case Opcode::Fle: return bool_const(a <= b);
+            case Opcode::Fge: return bool_const(a >= b);
+            default: return std::nullopt;
+        }
+    }
+
+    if(is(ValueKind::Bool)){
+        if(op == Opcode::Not && args.size() == 1) return bool_const(!args[0].value.b);
+        if(op == Opcode::And && args.size() == 2) return bool_const(args[0].value.b && args[1].value.b);
+        if(op == Opcode::Or && args.size() == 2) return bool_const(args[0].value.b || args[1].value.b);
+        return std::nullopt;
+    }
+
+    // chars are utf-8 strings; only single-byte ones are compared or converted here
+    if(is(ValueKind::Char)){
+        std::vector<int> codes;
+        for(const auto& arg: args){
+            const std::string& s = f.strings.name(arg.value.c);
+            if(s.size() != 1 || (unsigned char) s[0] >= 0x80) return std::nullopt;
+            codes.push_back(s[0]);
+        }
+        if(op == Opcode::Char2int && codes.size() == 1) return int_const(codes[0]);
+        if(codes.size() != 2) return std::nullopt;
+        switch(op){
+            case Opcode::Ceq: return bool_const(codes[0] == codes[1]);
+            case Opcode::Clt: return bool_const(codes[0] < codes[1]);
+            case Opcode::Cgt: return bool_const(codes[0] > codes[1]);
+            case Opcode::Cle: return bool_const(codes[0] <= codes[1]);
+            case Opcode::Cge: return bool_const(codes[0] >= codes[1]);
+            default: return std::nullopt;
+        }
+    }
+
+    return std::nullopt;
+}
+
+static bool is_foldable(Opcode op){
+    switch(op){
+        case Opcode::Add: case Opcode::Mul: case Opcode::Sub: case Opcode::Div:
+        case Opcode::Eq: case Opcode::Lt: case Opcode::Gt: case Opcode::Le: case Opcode::Ge:
+        case Opcode::Not: case Opcode::And: case Opcode::Or:
+        case Opcode::Fadd: case Opcode::Fmul: case Opcode::Fsub: case Opcode::Fdiv:
+        case Opcode::Feq: case Opcode::Flt: case Opcode::Fle: case Opcode::Fgt: case Opcode::Fge:
+        case Opcode::Ceq: case Opcode::Clt: case Opcode::Cle: case Opcode::Cgt: case Opcode::Cge:
+        case Opcode::Char2int:
+            return true;
+        default:
+            return false;
+    }
+}
+
+using InstrPos = std::pair<int,int>; // block and index in it
+
+SccpResult sccp_analyze(const Cfg& cfg, const CfgIr& cfg_ir){
+    const IrFunc& f = cfg_ir.ir;
+    int num_vars = f.vars.size();
+
+    SccpResult result;
+    auto& values = result.values;
+    auto& executable = result.executable;
+    values.resize(num_vars);
+    executable.resize(cfg.size());
+    result.branch_to.assign(cfg.size(), -1);
+    if(cfg.size() == 0) return result;
+
+    // def-use edges: uses of each var, the get defining each var, and the sets into each get
+    std::vector<std::vector<InstrPos>> uses(num_vars);
+    std::vector<InstrPos> get_of(num_vars, {-1, -1});
+    std::vector<std::vector<std::pair<int,SymId>>> sets_into(num_vars); // block of the set and var it sets
+    std::vector<int> num_defs(num_vars);
+    std::vector<int> label_block(f.labels.size(), -1);
+    for(const auto& param: f.params){
+        num_defs[param.var]++;
+    }
+    for(int b = 0; b < cfg.size(); b++){
+        auto block = cfg_ir.block(b);
+        for(int i = 0; i < block.size(); i++){
+            const auto& instr = block[i];
+            if(instr.op == Opcode::Label){
+                label_block[instr.dest] = b;
+                continue;
+            }
+            if(instr.keys & KEY_DEST){
+                num_defs[instr.dest]++;
+                if(instr.op == Opcode::Get) get_of[instr.dest] = {b, i};
+            }
+            auto args = instr_args(f, instr);
+            if(instr.op == Opcode::Set && args.size() == 2){
+                sets_into[args[0]].push_back({b, args[1]});
+                uses[args[1]].push_back({b, i});
+                continue;
+            }
+            for(SymId arg: args){
+                uses[arg].push_back({b, i});
+            }
+        }
+    }
+
+    // params and vars assigned more than once vary
+    for(SymId var = 0; var < num_vars; var++){
+        if(num_defs[var] > 1) values[var] = SccpValue::bottom();
+    }
+    for(const auto& param: f.params){
+        values[param.var] = SccpValue::bottom();
+    }
+
+    std::set<std::pair<int,int>> executable_edges;
+    std::vector<std::pair<int,int>> edge_work = {{-1, cfg.entryIdx}};
+    std::vector<SymId> var_work;
+
+    auto mark_edge = [&](int from, int to){
+        if(to >= 0 && !executable_edges.contains({from, to})) edge_work.push_back({from, to});
+    };
+
+    // value of the get at [pos]: the sets run on the executable edges into its block
+    auto eval_get = [&](InstrPos pos, SymId dest){
+        SccpValue v;
+        for(auto [p, src]: sets_into[dest]){
+            if(executable_edges.contains({p, pos.first})) lower(v, values[src]);
+        }
+        return v;
+    };
+
+    auto eval = [&](int b, int i){
+        const auto& instr = cfg_ir.block(b)[i];
+        auto args = instr_args(f, instr);
+
+        if(instr.op == Opcode::Br){
+            const auto& cond = values[args[0]];
+            auto labels = instr_labels(f, instr);
+            if(cond.is_const()){
+                int to = label_block[labels[cond.value.b ? 0 : 1]];
+                result.branch_to[b] = to;
+                mark_edge(b, to);
+            } else {
+                // bottom, or top from an undef: either way may be taken
+                result.branch_to[b] = -1;
+                for(SymId label: labels){
+                    mark_edge(b, label_block[label]);
+                }
+            }
+            return;
+        }
+
+        // a set feeds the get it targets
+        if(instr.op == Opcode::Set){
+            SymId target = args[0];
+            auto pos = get_of[target];
+            if(pos.first >= 0 && executable[pos.first] && lower(values[target], eval_get(pos, target))){
+                var_work.push_back(target);
+            }
+            return;
+        }
+
+        if(!(instr.keys & KEY_DEST)) return;
+
+        SccpValue v = SccpValue::bottom();
+        if(instr.op == Opcode::Const){
+            v = const_of(f, instr);
+        } else if(instr.op == Opcode::Id && args.size() == 1){
+            v = values[args[0]];
+        } else if(instr.op == Opcode::Get){
+            v = eval_get({b, i}, instr.dest);
+        } else if(instr.op == Opcode::Undef){
+            v = SccpValue();
+        } else if(is_foldable(instr.op)){
+            std::vector<SccpValue> consts;
+            bool has_top = false;
+            bool has_bottom = false;
+            for(SymId arg: args){
+                has_top |= values[arg].level == Level::Top;
+                has_bottom |= values[arg].level == Level::Bottom;
+                consts.push_back(values[arg]);
+            }
+            if(has_bottom){
+                v = SccpValue::bottom();
+            } else if(has_top){
+                v = SccpValue();
+            } else if(auto folded = fold(f, instr.op, consts)){
+                v = *folded;
+            }
+        }
+
+        if(lower(values[instr.dest], v)){
+            var_work.push_back(instr.dest);
+        }
+    };
+
+    while(!edge_work.empty() || !var_work.empty()){
+        if(!edge_work.empty()){
+            auto [from, to] = edge_work.back();
+            edge_work.pop_back();
+            if(from >= 0 && !executable_edges.insert({from, to}).second) continue;
+
+            auto block = cfg_ir.block(to);
+            if(executable[to]){
+                // only the gets see which edge was taken
+                for(int i = 0; i < block.size(); i++){
+                    if(block[i].op == Opcode::Get) eval(to, i);
+                }
+                continue;
+            }
+
+            // first time in: evaluate the whole block, then follow it unless it branches or returns
+            executable[to] = true;
+            for(int i = 0; i < block.size(); i++){
+                eval(to, i);
+            }
+            Opcode last = block.empty() ? Opcode::Nop : block.back().op;
+            if(last != Opcode::Br && last != Opcode::Ret){
+                for(int s: cfg.succs.at(to)){
+                    mark_edge(to, s);
+                }
+            }
+            continue;
+        }
+
+        SymId var = var_work.back();
+        var_work.pop_back();
+        for(auto [b, i]: uses[var]){
+            if(executable[b]) eval(b, i);
+        }
+    }
+
+    return result;
+}
+
+// json spelling of a constant
+static json const_json(const IrFunc& f, const SccpValue& v){
+    switch(v.kind){
+        case ValueKind::Int: return v.value.i;
+        case ValueKind::Float: return v.value.f;
+        case ValueKind::Bool: return v.value.b;
+        default: return f.strings.name(v.value.c);
+    }
+}
+
+void sccp(json& func){
+    AnalysisManager am(func);
+    sccp(func, am);
+}
+
+void sccp(json& func, AnalysisManager& am){
+    // a function with no instructions has no entry block to start from
+    if(am.get<CfgAnalysis>().size() == 0) return;
+    const CfgIr& cfg_ir = am.get<CfgIrAnalysis>();
+    const IrFunc& f = cfg_ir.ir;
+    SccpResult result = sccp_analyze(am.get<CfgAnalysis>(), cfg_ir);
+    Cfg cfg = take_cfg(func);
+
+    // defs of constants become consts, and sets into constant gets go; instructions still line up
+    // with the lowered body here, so branches are folded after
+    for(int b = 0; b < cfg.size(); b++){
+        if(!result.executable[b]) continue;
+        auto block_ir = cfg_ir.block(b);
+        auto& block = cfg.blocks[b];
+        std::vector<bool> dropped(block.size());
+        for(int i = 0; i < block_ir.size(); i++){
+            const auto& instr = block_ir[i];
+            auto args = instr_args(f, instr);
+            if(instr.op == Opcode::Set && args.size() == 2 && result.values[args[0]].is_const()){
+                dropped[i] = true;
+                continue;
+            }
+            if(!(instr.keys & KEY_DEST) || instr.op == Opcode::Const || !result.values[instr.dest].is_const()) continue;
+            block[i] = json{
+                {"dest", block[i]["dest"]},
+                {"op", "const"},
+                {"type", block[i]["type"]},
+                {"value", const_json(f, result.values[instr.dest])},
+            };
+        }
+        Block kept;
+        for(int i = 0; i < block.size(); i++){
+            if(!dropped[i]) kept.push_back(std::move(block[i]));
+        }
+        block = std::move(kept);
+    }
+
+    for(int b = 0; b < cfg.size(); b++){
+        if(result.executable[b] && result.branch_to[b] >= 0){
+            fold_branch(cfg, b, result.branch_to[b]);
+        }
+    }
+    delete_unreachable_blocks(cfg);
+
+    write_blocks(func, std::move(cfg.blocks), cfg.block_order);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../task2/cfg/cfg_utils.hpp"
+#include "../task2/cfg/analysis_manager.hpp"
+
+// value of an ssa var as sccp sees it: top until a def of it is found executable, then one constant,
+// or bottom once it can take more than one value
+struct SccpValue {
+    enum class Level : uint8_t { Top, Const, Bottom };
+
+    Level level = Level::Top;
+    ValueKind kind = ValueKind::None; // Int, Float, Bool or Char for a constant
+    decltype(Instr::value) value = {0}; // as in Instr; a Char is an id in IrFunc::strings
+
+    static SccpValue bottom() { return {Level::Bottom}; }
+    bool is_const() const { return level == Level::Const; }
+};
+
+struct SccpResult {
+    std::vector<SccpValue> values; // by var id of the CfgIr
+    std::vector<bool> executable;  // by block
+    std::vector<int> branch_to;    // by block, the only successor its br can take, -1 if not decided
+};
+
+// sparse conditional constant propagation over a function in ssa form (get/set, as to_ssa makes it):
+// values flow along def-use edges, and only out of blocks reached over executable edges. a get takes
+// the values of the sets in the predecessors it is entered from over an executable edge. vars with
+// more than one def are bottom, so code not in ssa form is left as is
+SccpResult sccp_analyze(const Cfg& cfg, const CfgIr& cfg_ir);
+
+// rewrite [func], in ssa form, with the result of sccp: defs of constants become consts (and sets into
+// constant gets are dropped), decided branches become jumps, and blocks no executable edge reaches
+// are deleted
+void sccp(json& func);
+
+// same, taking the cfg and lowered body from [am]
+void sccp(json& func, AnalysisManager& am);
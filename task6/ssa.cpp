@@ -1,35 +1,66 @@
+#include <mutex>
+
 #include "ssa_utils.hpp"
+#include "../task2/cfg/stream_utils.hpp"
 
 int main(int argc, char* argv[]) {
-    // get utility type
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << "<to|from>" << std::endl;
+    // number of functions to work on at once
+    int jobs;
+    try {
+        jobs = take_jobs_arg(argc, argv);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // get utility type and flags
+    PhiPlacement placement = PhiPlacement::Minimal;
+    bool show_stats = false;
+    bool bad_flag = false;
+    for (int i = 2; i < argc; i++) {
+        std::string flag = argv[i];
+        if (flag == "--pruned") placement = PhiPlacement::Pruned;
+        else if (flag == "--semi-pruned") placement = PhiPlacement::SemiPruned;
+        else if (flag == "--stats") show_stats = true;
+        else bad_flag = true;
+    }
+    if (argc < 2 || bad_flag) {
+        std::cerr << "Usage: " << argv[0] << " <to|from> [--pruned|--semi-pruned] [--stats] [-j N]" << std::endl;
         return 1;
     }
     std::string utility_type = argv[1];
+    if (utility_type != "to" && utility_type != "from") {
+        std::cerr << "ERROR: Unknown utility type, got " << utility_type << std::endl;
+        return 1;
+    }
+    if (utility_type == "from" && (placement != PhiPlacement::Minimal || show_stats)) {
+        std::cerr << "ERROR: --pruned, --semi-pruned and --stats only go with to" << std::endl;
+        return 1;
+    }
 
-    // open bril json
-    json j;
+    // convert each function as it is read; phi counts go to stderr, so the output stays comparable
+    std::mutex stats_lock;
+    auto convert = [&](json& func){
+        if (utility_type == "from") {
+            from_ssa(func);
+            return;
+        }
+        SsaStats stats;
+        to_ssa(func, placement, &stats);
+        if (show_stats) {
+            std::lock_guard<std::mutex> guard(stats_lock);
+            std::cerr << func["name"].get<std::string>() << ": " << stats.phis << " phis" << std::endl;
+        }
+    };
     try {
-        std::cin >> j;
+        transform_funcs(std::cin, std::cout, convert, jobs);
     } catch (const json::parse_error& e) {
         std::cerr << "ERROR: Failed to parse JSON from stdin, " << e.what() << std::endl;
         return 1;
+    } catch (const std::runtime_error& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
     }
-    
-    // do analysis
-    for(auto& func: j["functions"]){
-        if (utility_type == "to") {
-            to_ssa(func);
-        } else if (utility_type == "from") {
-            from_ssa(func);
-        } else {
-            std::cerr << "ERROR: Unknown utility type, got " << utility_type << std::endl;
-            return 1;
-        }
-    }
-
-    std::cout << j;
 
     return 0;
 }
@@ -1,37 +1,56 @@
 #include "ssa_utils.hpp"
 
-using PhiVars = std::map<int,std::set<std::string>>; // this type represents a map of blocks to vars for which they have phi-nodes
+using PhiVars = std::vector<std::vector<SymId>>; // this type represents, per block, the ids of vars (in name order) for which it has phi-nodes
 
-// get map of blocks to variable names for which they have phi-nodes
-PhiVars get_phi_vars(const json& func, const Cfg& cfg, const Dom& dom){
-    PhiVars phi_nodes;
+// get var ids used in some block before any def of them in that block; only these can need a
+// phi-node, the rest never carry a value from one block into another
+std::vector<bool> get_non_local_vars(const CfgIr& cfg_ir){
+    const IrFunc& f = cfg_ir.ir;
+    std::vector<bool> non_local(f.vars.size());
+    std::vector<int> defined_in(f.vars.size(), -1); // block in which each var was last seen defined
+    for(int b = 0; b < cfg_ir.ranges.size(); b++){
+        for(auto& instr: cfg_ir.block(b)){
+            for(SymId arg: instr_args(f, instr)){
+                if(defined_in[arg] != b) non_local[arg] = true;
+            }
+            if(instr.keys & KEY_DEST){
+                defined_in[instr.dest] = b;
+            }
+        }
+    }
+    return non_local;
+}
 
-    // get names of vars and blocks in which they are assigned
-    std::set<std::string> vars;
-    std::map<std::string,std::vector<int>> defs;
+// get blocks to variable ids for which they have phi-nodes; [live] is the liveness of the cfg when
+// phi-nodes are pruned, and [non_local] the vars that may have any when semi-pruned
+PhiVars get_phi_vars(const CfgIr& cfg_ir, const Cfg& cfg, const DomFrontier& front, const BitFacts* live, const std::vector<bool>* non_local){
+    // get blocks in which each var is assigned
+    const IrFunc& f = cfg_ir.ir;
+    std::vector<std::vector<int>> defs(f.vars.size());
     for(int i = 0; i < cfg.blocks.size(); i++){
-        phi_nodes[i];
-        phi_nodes.at(i);
-        auto& block = cfg.blocks[i];
-        for(auto& instr: block){
-            if(instr.contains("dest")){
-                auto dest = instr["dest"];
-                vars.insert(dest);
-                defs[dest].push_back(i);
+        for(auto& instr: cfg_ir.block(i)){
+            if(instr.keys & KEY_DEST){
+                auto& cur_defs = defs[instr.dest];
+                if(cur_defs.empty() || cur_defs.back() != i){
+                    cur_defs.push_back(i);
+                }
             }
         }
     }
 
-    // get dominance frontiers
-    DomFrontier front = get_dom_frontier(dom, cfg);
-    
-    // place phi-nodes
-    for(auto var: vars){
+    // place phi-nodes; vars are visited in id order, so each block's list stays sorted
+    PhiVars phi_nodes(cfg.blocks.size());
+    for(SymId var = 0; var < defs.size(); var++){
+        if(non_local && !(*non_local)[var]) continue;
         auto& cur_defs = defs[var];
         for(int i = 0; i < cur_defs.size(); i++){
             auto d = cur_defs[i];
-            for(auto b: front[d]){
-                phi_nodes[b].insert(var);
+            for(auto b: front.at(d)){
+                // a var dead into the block needs no phi-node there, and so is not defined there
+                if(live && !live->second[b].test(var)) continue;
+                if(phi_nodes[b].empty() || phi_nodes[b].back() != var){
+                    phi_nodes[b].push_back(var);
+                }
                 if(std::find(cur_defs.begin(), cur_defs.end(), b) == cur_defs.end()){
                     cur_defs.push_back(b);
                 }
@@ -42,13 +61,13 @@ PhiVars get_phi_vars(const json& func, const Cfg& cfg, const Dom& dom){
     return phi_nodes;
 }
 
-using NameLog = std::map<std::string,std::stack<std::string>>;
-using NameCount = std::map<std::string,int>;
-using PhiGets = std::map<int,std::map<std::string,std::string>>; // map of block id to map of original var to name to get as
-using PhiSets =  std::map<int,std::vector<std::tuple<std::string,std::string,int>>>; // tuples of (original var, what to set it with, block id of block where phi node is located)
+using NameLog = std::vector<std::stack<std::string>>; // var id to stack of its current names
+using NameCount = std::vector<int>;
+using PhiGets = std::map<int,std::map<SymId,std::string>>; // map of block id to map of original var to name to get as
+using PhiSets =  std::map<int,std::vector<std::tuple<SymId,std::string,int>>>; // tuples of (original var, what to set it with, block id of block where phi node is located)
 using UndefInits = std::map<int,std::vector<std::pair<std::string,std::string>>>; // map of block id to list of (var name, type) which need to be assigned undef at start of block
 
-void rename(int block_id, Cfg& cfg, const DomTree& tree, const PhiVars& phi_vars, NameLog& name_log, NameCount& name_count, PhiGets& phi_gets, PhiSets& phi_sets, UndefInits& undefs, const std::map<std::string,std::string>& var_to_type){    
+void rename(int block_id, Cfg& cfg, const CfgIr& cfg_ir, const DomTree& tree, const PhiVars& phi_vars, NameLog& name_log, NameCount& name_count, PhiGets& phi_gets, PhiSets& phi_sets, UndefInits& undefs, const std::vector<std::string>& var_to_type){
     // initialize undefs and phi gets and sets as empty
     phi_gets[block_id];
     phi_sets[block_id];
@@ -56,34 +75,40 @@ void rename(int block_id, Cfg& cfg, const DomTree& tree, const PhiVars& phi_vars
 
     // rename within current block
     auto& blocks = cfg.blocks;
-    std::map<std::string,int> rename_count;
+    const auto& vars = cfg_ir.ir.vars;
+    std::vector<SymId> pushed;
 
     // rename all phi-node dests
     for(auto var: phi_vars.at(block_id)){
-        auto new_name = var + "." + std::to_string(name_count[var]);
+        auto new_name = vars.name(var) + "." + std::to_string(name_count[var]);
         name_count[var]++;
         name_log[var].push(new_name);
-        rename_count[var]++;
+        pushed.push_back(var);
         phi_gets[block_id][var] = new_name;
     }
 
     // rename args and dests within current block
-    for(auto& instr: blocks[block_id]){
+    auto block_ir = cfg_ir.block(block_id);
+    for(int i = 0; i < block_ir.size(); i++){
+        auto& instr = blocks[block_id][i];
+        const auto& instr_ir = block_ir[i];
+
         // process usages (args)
         if(instr.contains("args")){
-            for(auto& arg: instr["args"]){
+            auto args = instr_args(cfg_ir.ir, instr_ir);
+            for(int j = 0; j < args.size(); j++){
                 // read current name
-                arg = name_log[arg].top();
+                instr["args"][j] = name_log[args[j]].top();
             }
         }
 
         // rename dest
-        if(instr.contains("dest")){
-            auto dest = instr["dest"];
-            instr["dest"] = instr["dest"].get<std::string>() + "." + std::to_string(name_count[dest]);
+        if(instr_ir.keys & KEY_DEST){
+            SymId dest = instr_ir.dest;
+            instr["dest"] = vars.name(dest) + "." + std::to_string(name_count[dest]);
             name_count[dest]++;
             name_log[dest].push(instr["dest"]);
-            rename_count[dest]++;
+            pushed.push_back(dest);
         }
     }
 
@@ -91,9 +116,9 @@ void rename(int block_id, Cfg& cfg, const DomTree& tree, const PhiVars& phi_vars
     for(auto s: cfg.succs.at(block_id)){
         for(auto p: phi_vars.at(s)){
             if(name_log[p].empty()){
-                auto new_name = p + "." + std::to_string(block_id) + "." + "init";
+                auto new_name = vars.name(p) + "." + std::to_string(block_id) + "." + "init";
                 name_log[p].push(new_name);
-                rename_count[p]++;
+                pushed.push_back(p);
                 undefs[block_id].push_back(std::make_pair(new_name, var_to_type.at(p)));
             }
             phi_sets[block_id].push_back(std::make_tuple(p, name_log[p].top(), s));
@@ -102,14 +127,12 @@ void rename(int block_id, Cfg& cfg, const DomTree& tree, const PhiVars& phi_vars
 
     // rename children
     for(auto child: tree.at(block_id)){
-        rename(child, cfg, tree, phi_vars, name_log, name_count, phi_gets, phi_sets, undefs, var_to_type);
+        rename(child, cfg, cfg_ir, tree, phi_vars, name_log, name_count, phi_gets, phi_sets, undefs, var_to_type);
     }
 
     // pop pushed names
-    for(auto [var, count]: rename_count){
-        for(int i = 0; i < count; i++){
-            name_log[var].pop();
-        }
+    for(SymId var: pushed){
+        name_log[var].pop();
     }
 }
 
@@ -117,9 +140,9 @@ bool is_jump(const json& instr){
     return instr.contains("op") && (instr["op"]=="jmp" || instr["op"]=="br");
 }
 
-// insert sets, gets, and udefs
-std::vector<Block> insert_sets_gets_undefs(const Cfg& cfg, const PhiSets& phi_sets, const PhiGets& phi_gets, const UndefInits& undefs, const std::map<std::string,std::string>& var_to_type){
-    auto blocks = cfg.blocks;
+// insert sets, gets, and udefs into the blocks of [cfg]
+void insert_sets_gets_undefs(Cfg& cfg, const PhiSets& phi_sets, const PhiGets& phi_gets, const UndefInits& undefs, const std::vector<std::string>& var_to_type){
+    auto& blocks = cfg.blocks;
     
     for(int i = 0; i < blocks.size(); i++){
         auto& block = blocks[i];
@@ -162,7 +185,6 @@ std::vector<Block> insert_sets_gets_undefs(const Cfg& cfg, const PhiSets& phi_se
                 auto var_orig = std::get<0>(tup);
                 auto var_set = std::get<1>(tup);
                 auto phi_block = std::get<2>(tup);
-                auto temp = phi_gets.at(phi_block);
                 auto set_dest = phi_gets.at(phi_block).at(var_orig);
                 auto set_instr = json{
                     {"op", "set"},
@@ -177,68 +199,77 @@ std::vector<Block> insert_sets_gets_undefs(const Cfg& cfg, const PhiSets& phi_se
         }
     }
 
-    return blocks;
 }
 
-// get map of vars to type
-std::map<std::string,std::string> get_var_to_type(const json& func){
-    std::map<std::string,std::string> var_to_type;
-    for(const auto& instr: func["instrs"]){
-        if(instr.contains("type")){
-            std::string type;
-            if(instr["type"].contains("ptr")){
-                type = "ptr<" + instr["type"]["ptr"].get<std::string>() + ">";
-            } else{
-                type = instr["type"];
-            }
-            var_to_type[instr["dest"]] = type;
+// get var ids to type
+std::vector<std::string> get_var_to_type(const IrFunc& f){
+    std::vector<std::string> var_to_type(f.vars.size());
+    for(const auto& instr: f.instrs){
+        if((instr.keys & KEY_TYPE) && (instr.keys & KEY_DEST)){
+            var_to_type[instr.dest] = f.types.name(instr.type);
         }
     }
     return var_to_type;
 }
 
 void to_ssa(json& func){
-    // get utils
-    Cfg cfg = get_cfg_func(func);
-    Dom dom = get_dom(func);
-    DomTree tree = get_dom_tree(dom, cfg);
+    AnalysisManager am(func);
+    to_ssa(func, am);
+}
+
+void to_ssa(json& func, PhiPlacement placement, SsaStats* stats){
+    AnalysisManager am(func);
+    to_ssa(func, am, placement, stats);
+}
 
-    // get map of blocks to variables for which they need phi-nodes
-    auto phi_vars = get_phi_vars(func, cfg, dom);
+void to_ssa(json& func, AnalysisManager& am, PhiPlacement placement, SsaStats* stats){
+    // a function with no instructions has no entry block to rename from
+    if(am.get<CfgAnalysis>().size() == 0) return;
+
+    // get utils, before the body is taken out of func
+    const CfgIr& cfg_ir = am.get<CfgIrAnalysis>();
+    const IrFunc& f = cfg_ir.ir;
+    const DomTree& tree = am.get<DomTreeAnalysis>();
+    const DomFrontier& front = am.get<DomFrontierAnalysis>();
+    const BitFacts* live = placement == PhiPlacement::Pruned ? &am.get<LiveVarsAnalysis>() : nullptr;
+    std::vector<bool> non_local;
+    if(placement == PhiPlacement::SemiPruned) non_local = get_non_local_vars(cfg_ir);
+    Cfg cfg = take_cfg(func);
+
+    // get blocks to variables for which they need phi-nodes
+    auto phi_vars = get_phi_vars(cfg_ir, cfg, front, live, placement == PhiPlacement::SemiPruned ? &non_local : nullptr);
+    if(stats){
+        for(const auto& vars: phi_vars){
+            stats->phis += vars.size();
+        }
+    }
 
     // get sets and gets
-    NameLog name_log;
-    for(auto& arg: func["args"]){
-        auto& arg_name = arg["name"];
-        name_log[arg_name].push(arg_name);
+    NameLog name_log(f.vars.size());
+    for(const auto& param: f.params){
+        name_log[param.var].push(f.vars.name(param.var));
     }
-    NameCount name_count;
+    NameCount name_count(f.vars.size());
     PhiGets phi_gets;
     PhiSets phi_sets;
     UndefInits undefs;
-    auto var_to_type = get_var_to_type(func);
-    rename(cfg.entryIdx, cfg, tree, phi_vars, name_log, name_count, phi_gets, phi_sets, undefs, var_to_type);
+    auto var_to_type = get_var_to_type(f);
+    rename(cfg.entryIdx, cfg, cfg_ir, tree, phi_vars, name_log, name_count, phi_gets, phi_sets, undefs, var_to_type);
 
     // insert sets and gets in blocks
-    std::vector<Block> ssa_blocks = insert_sets_gets_undefs(cfg, phi_sets, phi_gets, undefs, var_to_type);
+    insert_sets_gets_undefs(cfg, phi_sets, phi_gets, undefs, var_to_type);
     
     // rewrite func as SSA
-    std::vector<json> new_func_body;
-    for(int b_id: cfg.block_order){
-        auto& b = ssa_blocks[b_id];
-        new_func_body.insert(new_func_body.end(), b.begin(), b.end());
-    }
-    func["instrs"] = new_func_body;
+    write_blocks(func, std::move(cfg.blocks), cfg.block_order);
 }
 
 void from_ssa(json& func) {
-    Cfg cfg = get_cfg_func(func);
-    std::vector<Block> blocks = cfg.blocks;
+    std::vector<Block> blocks = take_blocks(func);
 
     // get all "get" instructions and their types in a map
     std::map<std::string, std::string> gets;
-    for (Block block: blocks) {
-        for (auto instr: block) {
+    for (const Block& block: blocks) {
+        for (const auto& instr: block) {
             if (instr.contains("op") && instr["op"] == "get") {
                 gets[instr["dest"]] = instr["type"];
             }
@@ -247,7 +278,6 @@ void from_ssa(json& func) {
 
     // replace all sets with new def using get map
     // don't handle undefs
-    std::vector<json> new_func_body;
     for (Block& block: blocks) {
         Block new_block;
         for (int i = 0; i < block.size(); i++) {
@@ -261,15 +291,15 @@ void from_ssa(json& func) {
                 auto new_instr = json{
                     {"op", "id"},
                     {"dest", instr["args"][0]}, 
-                    {"op", gets[instr["args"][0]]}, 
+                    {"type", gets[instr["args"][0]]},
                     {"args", {instr["args"][1]}},
                 };
                 block[i] = new_instr;
             }
-            new_block.push_back(instr);
+            new_block.push_back(std::move(instr));
         }
-        new_func_body.insert(new_func_body.end(), new_block.begin(), new_block.end());
+        block = std::move(new_block);
     }
 
-    func["instrs"] = new_func_body;
+    write_blocks(func, std::move(blocks));
 }
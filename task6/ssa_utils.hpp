@@ -8,7 +8,23 @@
 #include <stack>
 #include <map>
 
+#include "../task4/dataflow_utils.hpp"
 #include "../task5/dom_utils.hpp"
 
+// where to_ssa puts phi-nodes (get/set pairs): minimal ssa puts one for a var at every block in
+// the iterated dominance frontier of its defs; semi-pruned only does so for vars used in some block
+// before being defined in it, and pruned only where the var is live into the block
+enum class PhiPlacement { Minimal, SemiPruned, Pruned };
+
+struct SsaStats {
+    int phis = 0; // phi-nodes placed, one per var and block
+};
+
 void to_ssa(json& func);
+
+// same, placing phi-nodes by [placement] and counting them into [stats]
+void to_ssa(json& func, PhiPlacement placement, SsaStats* stats = nullptr);
+
+// same, taking the lowered body, dominator tree and frontier (and liveness when pruned) from [am]
+void to_ssa(json& func, AnalysisManager& am, PhiPlacement placement = PhiPlacement::Minimal, SsaStats* stats = nullptr);
 void from_ssa(json& func);
\ No newline at end of file
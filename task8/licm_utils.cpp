@@ -0,0 +1,137 @@
+#include "licm_utils.hpp"
+
+// insert loop preheaders, returning the preheader of each loop
+auto insert_preheaders(Cfg& cfg, const LoopForest& forest){
+    std::vector<int> phs;
+    for(const Loop& loop: forest.loops){
+        // every edge into the header from outside the loop now enters through the preheader
+        int h = loop.header;
+        std::vector<int> entries;
+        for(int p: cfg.preds.at(h)){
+            if(!std::binary_search(loop.latches.begin(), loop.latches.end(), p)) entries.push_back(p);
+        }
+        phs.push_back(insert_block_before(cfg, h, entries, block_label(cfg, h) + "_ph"));
+    }
+
+    return phs;
+}
+
+const std::set<std::string> side_effect_ops = {"set","get","br","div","print","call","store","load"};
+
+// get loop-invariant insns of loop [l], as indices into the function body, each after the insns
+// it depends on. an arg is invariant if every def reaching it is outside the loop, or its only
+// reaching def is a loop-invariant insn
+auto get_loop_inv_instrs(int l, const LoopForest& forest, const Cfg& cfg, const CfgIr& cfg_ir, const DefUse& du){
+    std::vector<bool> is_inv(cfg_ir.ir.instrs.size());
+    std::vector<int> inv_instrs;
+
+    auto arg_inv = [&](int i, int arg){
+        auto defs = du.reaching(i, arg);
+        if(defs.size() == 1 && du.def_instr(defs[0]) != -1 && is_inv[du.def_instr(defs[0])]) return true;
+        return std::none_of(defs.begin(), defs.end(), [&](int d){ return forest.contains(l, du.def_block(d)); });
+    };
+
+    bool changed = true;
+    while(changed){
+        changed = false;
+
+        for(int b: forest.loops[l].blocks){
+            auto block = cfg.block(b);
+            for(int k = 0; k < block.size(); k++){
+                auto& instr = block[k];
+                int i = cfg_ir.ranges[b].begin + k;
+                if(is_inv[i] || !instr.contains("dest") || !instr.contains("op") || side_effect_ops.contains(instr["op"])) continue;
+
+                // check if instr is loop-invariant
+                bool inv = true;
+                for(int arg = 0; inv && arg < cfg_ir.ir.instrs[i].num_args; arg++){
+                    inv = arg_inv(i, arg);
+                }
+
+                // mark as loop-invariant
+                if(inv){
+                    is_inv[i] = true;
+                    inv_instrs.push_back(i);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    return inv_instrs;
+}
+
+// move the insns at [moves] (block, index) out of the loop bodies, grouped by the loop they leave
+auto take_instrs(const std::map<int,std::vector<std::pair<int,int>>>& moves, Cfg& cfg){
+    std::map<int,std::vector<json>> taken;
+    std::map<int,std::set<int>> mp;
+    for(auto& [l, at]: moves){
+        for(auto [b, idx]: at){
+            mp[b].insert(idx);
+            taken[l].push_back(std::move(cfg.blocks[b][idx]));
+        }
+    }
+
+    // remove instrs from loop body
+    for(auto& [b, remove]: mp){
+        Block new_block;
+        for(int i = 0; i < cfg.blocks[b].size(); i++){
+            if(!remove.contains(i)) new_block.push_back(std::move(cfg.blocks[b][i]));
+        }
+        cfg.blocks[b] = std::move(new_block);
+    }
+
+    return taken;
+}
+
+// replace function body of [func] with blocks in [cfg]
+void replace_func_body(Cfg& cfg, json& func){
+    write_blocks(func, std::move(cfg.blocks), cfg.block_order);
+}
+
+// rewrite func with LICM
+void licm(json& func){
+    AnalysisManager am(func);
+    licm(func, am);
+}
+
+void licm(json& func, AnalysisManager& am){
+    const LoopForest& forest = am.get<LoopForestAnalysis>();
+    const Cfg& view = am.get<CfgAnalysis>();
+    const CfgIr& cfg_ir = am.get<CfgIrAnalysis>();
+    const DefUse& du = am.get<DefUseAnalysis>();
+
+    // find the loop-invariant insns of each loop while the analyses still see the body; one
+    // invariant in nested loops leaves the outermost of them, so loops go outermost first
+    std::vector<int> loops(forest.loops.size());
+    std::iota(loops.begin(), loops.end(), 0);
+    std::stable_sort(loops.begin(), loops.end(), [&](int a, int b){ return forest.loops[a].depth < forest.loops[b].depth; });
+
+    std::vector<int> instr_block(cfg_ir.ir.instrs.size());
+    for(int b = 0; b < cfg_ir.ranges.size(); b++){
+        for(int i = cfg_ir.ranges[b].begin; i < cfg_ir.ranges[b].end; i++) instr_block[i] = b;
+    }
+    std::vector<bool> hoisted(cfg_ir.ir.instrs.size());
+    std::map<int,std::vector<std::pair<int,int>>> moves;
+    for(int l: loops){
+        for(int i: get_loop_inv_instrs(l, forest, view, cfg_ir, du)){
+            if(hoisted[i]) continue;
+            hoisted[i] = true;
+            int b = instr_block[i];
+            moves[l].push_back({b, i - cfg_ir.ranges[b].begin});
+        }
+    }
+
+    // take insns out of the loops, then make preheaders and move them in
+    Cfg cfg = take_cfg(func);
+    auto taken = take_instrs(moves, cfg);
+    auto phs = insert_preheaders(cfg, forest);
+    for(auto& [l, instrs]: taken){
+        for(auto& instr: instrs){
+            cfg.blocks[phs[l]].push_back(std::move(instr));
+        }
+    }
+
+    // write new func body
+    replace_func_body(cfg, func);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <stack>
+#include <map>
+
+#include "../task4/dataflow_utils.hpp"
+#include "../task5/dom_utils.hpp"
+
+// move loop-invariant instructions of [func] into new loop preheaders
+void licm(json& func);
+
+// same, taking dominators from [am]
+void licm(json& func, AnalysisManager& am);